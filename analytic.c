@@ -9,6 +9,13 @@ data_t *make_empty_data(int num_children) {
     return new_data;
 }
 
+/* Counts one turn with the given states in data */
+static void count_turn(data_t *data, int win_state, int bad_state) {
+    data->count_num++;
+    if (win_state) data->count_win++;
+    if (bad_state) data->count_bad++;
+}
+
 /* Traverse tree by depth and updating child_data structs */
 void traverse_and_analyze(turn_t *parent, int depth, data_t *total, 
         data_t *depth_total, data_t **depth_sorted) {
@@ -23,19 +30,10 @@ void traverse_and_analyze(turn_t *parent, int depth, data_t *total,
     } else {
         /* You are at appropriate depth, add where necessary */
         int num_children = parent->num_children;
-        total->count_num++;
-        depth_total->count_num++;
-        depth_sorted[num_children]->count_num++;
-        if (parent->win_state) {
-            total->count_win++;
-            depth_total->count_win++;
-            depth_sorted[num_children]->count_win++;
-        }
-        if (parent->bad_state) {
-            total->count_bad++;
-            depth_total->count_bad++;
-            depth_sorted[num_children]->count_bad++;
-        }
+        count_turn(total, parent->win_state, parent->bad_state);
+        count_turn(depth_total, parent->win_state, parent->bad_state);
+        count_turn(depth_sorted[num_children], parent->win_state,
+                parent->bad_state);
     }
 }
 
@@ -84,4 +82,41 @@ void branching_data(turn_t *root, int depth) {
             total->count_win,
             total->count_bad);
     free(total);
-}
\ No newline at end of file
+}
+
+/* Diagnostics for branching information of a level-generated game */
+void level_branching_data(level_tree_t *tree) {
+    assert(tree);
+    data_t *total, *depth_total;
+    data_t *depth_sorted[NUM_SQUARES+1];
+    total = make_empty_data(ANY_CHILD);
+
+    /* Each layer is one depth, so analyze & print them in turn */
+    int i, j;
+    for (i = 0; i < tree->num_layers; i++) {
+        layer_t *layer = &tree->layers[i];
+        printf("Depth: %d\n", i);
+        depth_total = make_empty_data(ANY_CHILD);
+        for (j = 0; j < NUM_SQUARES+1; j++) {
+            depth_sorted[j] = make_empty_data(j);
+        }
+        for (j = 0; j < layer->num_nodes; j++) {
+            int win_state = layer->flags[j] & LEVEL_WIN;
+            int bad_state = layer->flags[j] & LEVEL_BAD;
+            count_turn(total, win_state, bad_state);
+            count_turn(depth_total, win_state, bad_state);
+            count_turn(depth_sorted[level_num_children(layer, j)], win_state,
+                    bad_state);
+        }
+        print_depth_data(depth_total, depth_sorted);
+        free(depth_total);
+        for (j = 0; j < NUM_SQUARES+1; j++) {
+            free(depth_sorted[j]);
+        }
+    }
+    printf("Grand totals: %d turns, %d wins, %d bads\n",
+            total->count_num,
+            total->count_win,
+            total->count_bad);
+    free(total);
+}
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "game_struct.h"
+#include "level_gen.h"
 
 #define ANY_CHILD -1
 
@@ -22,5 +23,6 @@ void traverse_and_analyze(turn_t *parent, int depth, data_t *total,
         data_t *depth_total, data_t **depth_sorted);
 void print_depth_data(data_t *depth_total, data_t **depth_sorted);
 void branching_data(turn_t *root, int depth);
+void level_branching_data(level_tree_t *tree);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "background.h"
+
+/* Background work on the shared tree. The whole tree is generated layer by
+ * layer on a worker thread, exactly as generate_children would, while the
+ * simulator plays on it; and while the human thinks, a ponder thread does
+ * the computer's next step for each likely reply in advance. Workers take
+ * the tree lock one subtree of CHUNK_DEPTH at a time, and the simulator
+ * takes it around everything it reads or expands. */
+
+static pthread_mutex_t tree_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* State of the generation worker */
+static pthread_t worker;
+static int worker_running = FALSE;
+static atomic_int worker_done = TRUE;
+static atomic_int worker_stop = FALSE;
+static turn_t *worker_root = NULL;
+static int worker_depth = 0;
+
+/* State of the ponder thread, and what it found for each reply */
+static pthread_t ponderer;
+static int ponder_running = FALSE;
+static atomic_int ponder_stop = FALSE;
+static turn_t *ponder_curr = NULL;
+static ponder_t ponder_replies[NUM_SQUARES];
+static int num_ponder_replies = 0;
+
+/**===================================LOCK===================================**/
+
+/* Takes exclusive use of the shared tree */
+void tree_lock(void) {
+    pthread_mutex_lock(&tree_mutex);
+}
+
+/* Releases the shared tree */
+void tree_unlock(void) {
+    pthread_mutex_unlock(&tree_mutex);
+}
+
+/**================================GENERATION================================**/
+
+/* Copies parent's children under the lock, as complete_children may swap the
+    array; returns how many there are */
+static int snapshot_children(turn_t *parent, turn_t *stor[]) {
+    int i;
+    for (i = 0; i < parent->num_children; i++) {
+        stor[i] = parent->children[i];
+    }
+    return parent->num_children;
+}
+
+/* As traverse_and_create, with the lock held, but checking for a stop before
+    each turn so a big subtree cannot hold it up */
+static void create_locked(turn_t *parent, atomic_int *stop) {
+    if (((parent->win_state || parent->bad_state) &&
+            parent->move.entry != EMPTY) || parent->repeat_state) {
+        return;
+    }
+    if (parent->num_children == EMPTY) {
+        traverse_and_create(parent);
+        return;
+    }
+    int i;
+    for (i = 0; i < parent->num_children && !*stop; i++) {
+        create_locked(parent->children[i], stop);
+    }
+}
+
+/* As traverse_and_create, taking the lock once per subtree at CHUNK_DEPTH */
+static void create_chunked(turn_t *parent, int level, atomic_int *stop) {
+    turn_t *children[NUM_SQUARES];
+    tree_lock();
+    if (((parent->win_state || parent->bad_state) &&
+            parent->move.entry != EMPTY) || parent->repeat_state) {
+        tree_unlock();
+        return;
+    }
+    if (level == CHUNK_DEPTH || parent->num_children == EMPTY) {
+        create_locked(parent, stop);
+        tree_unlock();
+        return;
+    }
+    int i, num_children = snapshot_children(parent, children);
+    tree_unlock();
+    for (i = 0; i < num_children && !*stop; i++) {
+        create_chunked(children[i], level + 1, stop);
+    }
+}
+
+/* As traverse_and_update, taking the lock once per subtree at CHUNK_DEPTH */
+static void update_chunked(turn_t *parent, int level, atomic_int *stop) {
+    turn_t *children[NUM_SQUARES];
+    tree_lock();
+    if (level == CHUNK_DEPTH) {
+        traverse_and_update(parent);
+        tree_unlock();
+        return;
+    }
+    int i, num_children = snapshot_children(parent, children);
+    tree_unlock();
+    for (i = 0; i < num_children && !*stop; i++) {
+        update_chunked(children[i], level + 1, stop);
+    }
+    tree_lock();
+    update_bad_states(parent);
+    update_win_states(parent);
+    prune_decided(parent);
+    tree_unlock();
+}
+
+/* generate_children(root, 1) a chunk at a time; returns FALSE if stopped
+    part way through */
+static int generate_layer_chunked(turn_t *root, atomic_int *stop) {
+    tree_lock();
+    root->repeat_state = FALSE;
+    tree_unlock();
+    create_chunked(root, 0, stop);
+    update_chunked(root, 0, stop);
+    return !*stop;
+}
+
+/* Worker body: generate_children on worker_root, a chunk at a time */
+static void *generation_worker(void *arg) {
+    int i;
+    for (i = 0; i < worker_depth && !worker_stop; i++) {
+        generate_layer_chunked(worker_root, &worker_stop);
+    }
+    worker_done = TRUE;
+    return NULL;
+}
+
+/* Starts generating depth layers below root on a worker thread */
+void start_background_generation(turn_t *root, int depth) {
+    assert(root);
+    assert(!worker_running);
+    worker_root = root;
+    worker_depth = depth;
+    worker_done = FALSE;
+    worker_stop = FALSE;
+    if (pthread_create(&worker, NULL, generation_worker, NULL) != 0) {
+        /* No thread to spare; generate up front instead */
+        generate_children(root, depth);
+        worker_done = TRUE;
+        return;
+    }
+    worker_running = TRUE;
+}
+
+/* Checks if background generation has finished */
+int background_generation_done(void) {
+    return worker_done;
+}
+
+/* Blocks until background generation has finished */
+void wait_background_generation(void) {
+    if (!worker_running) return;
+    pthread_join(worker, NULL);
+    worker_running = FALSE;
+}
+
+/* Abandons background generation at its next chunk and waits for it */
+void stop_background_generation(void) {
+    worker_stop = TRUE;
+    wait_background_generation();
+}
+
+/**=================================PONDERING================================**/
+
+/* Ranks replies by how likely the human is to play them: winning moves,
+    then undecided ones, then bad ones */
+static int reply_rank(turn_t *reply) {
+    if (reply->win_state) return 0;
+    if (reply->bad_state) return 2;
+    return 1;
+}
+
+/* Ponder body: in rounds, deepen each reply of ponder_curr by one layer,
+    as the computer would on its turn, then record the computer's answer. It
+    is settled only if background generation, which could still deepen the
+    reply, had finished by then */
+static void *ponder_worker(void *arg) {
+    int round, i, sym;
+    for (round = 0; round < PONDER_LAYERS && !ponder_stop; round++) {
+        for (i = 0; i < num_ponder_replies && !ponder_stop; i++) {
+            ponder_t *reply = &ponder_replies[i];
+            if (reply->layers > round) continue;    /* Done before a stop */
+            if (book_lookup(reply->turn->key, &sym)) continue;  /* Booked */
+            reply->settled = FALSE;
+            if (!generate_layer_chunked(reply->turn, &ponder_stop)) break;
+            tree_lock();
+            reply->best = eval_best_child(reply->turn,
+                    best_child(reply->turn));
+            reply->settled = worker_done;
+            tree_unlock();
+            reply->layers++;
+        }
+    }
+    return NULL;
+}
+
+/* Starts pondering the human's replies at curr, keeping earlier results if
+    curr was already being pondered */
+void start_pondering(turn_t *curr) {
+    assert(curr);
+    assert(!ponder_running);
+    /* Pruning may free the replies it would hold on to */
+    if (pruning_enabled()) return;
+    int i, j, rank;
+    tree_lock();
+    if (curr != ponder_curr) {
+        ponder_curr = curr;
+        num_ponder_replies = 0;
+        if (curr->num_children) complete_children(curr);
+        for (rank = 0; rank < 3; rank++) {
+            for (i = 0; i < curr->num_children; i++) {
+                if (reply_rank(curr->children[i]) != rank) continue;
+                j = num_ponder_replies++;
+                ponder_replies[j].turn = curr->children[i];
+                ponder_replies[j].layers = 0;
+                ponder_replies[j].settled = FALSE;
+            }
+        }
+    }
+    tree_unlock();
+    ponder_stop = FALSE;
+    if (num_ponder_replies && pthread_create(&ponderer, NULL, ponder_worker,
+            NULL) == 0) {
+        ponder_running = TRUE;
+    }
+}
+
+/* Stops pondering once the current chunk is done */
+void stop_pondering(void) {
+    if (!ponder_running) return;
+    ponder_stop = TRUE;
+    pthread_join(ponderer, NULL);
+    ponder_running = FALSE;
+}
+
+/* Drops what pondering found, before the simulator changes the tree below
+    the pondered turn itself */
+void forget_pondering(void) {
+    assert(!ponder_running);
+    ponder_curr = NULL;
+    num_ponder_replies = 0;
+}
+
+/* Checks if every reply at curr was deepened by pondering or is booked, so
+    needs no layer before the human picks one */
+int replies_pondered(turn_t *curr) {
+    assert(!ponder_running);
+    int i, sym;
+    if (curr != ponder_curr || !num_ponder_replies) return FALSE;
+    for (i = 0; i < num_ponder_replies; i++) {
+        ponder_t *reply = &ponder_replies[i];
+        if (!reply->layers && !book_lookup(reply->turn->key, &sym)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Writes the computer's pondered answer to reply into best; returns FALSE
+    if reply was not pondered, or the tree below it has changed since */
+int pondered_move(turn_t *reply, best_child_t *best) {
+    assert(!ponder_running);
+    int i;
+    for (i = 0; i < num_ponder_replies; i++) {
+        ponder_t *reply_found = &ponder_replies[i];
+        if (reply_found->turn == reply && reply_found->layers &&
+                reply_found->settled) {
+            *best = reply_found->best;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
@@ -0,0 +1,41 @@
+#ifndef _BACKGROUND
+#define _BACKGROUND
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "game_struct.h"
+#include "book.h"
+#include "eval.h"
+
+#define CHUNK_DEPTH 2   /* Worker holds the tree lock per subtree this deep */
+#define PONDER_LAYERS 4 /* Most layers pondered below each reply */
+
+/* What pondering found for one of the human's replies */
+typedef struct {
+    turn_t *turn;
+    int layers;         /* Layers generated below turn by pondering */
+    best_child_t best;  /* Computer's answer after the last of them */
+    int settled;        /* TRUE while nothing else has changed turn since */
+} ponder_t;
+
+/* Tree sharing between the simulator and background work */
+void tree_lock(void);
+void tree_unlock(void);
+
+/* Background generation */
+void start_background_generation(turn_t *root, int depth);
+int background_generation_done(void);
+void wait_background_generation(void);
+void stop_background_generation(void);
+
+/* Pondering on the human's turn */
+void start_pondering(turn_t *curr);
+void stop_pondering(void);
+void forget_pondering(void);
+int replies_pondered(turn_t *curr);
+int pondered_move(turn_t *reply, best_child_t *best);
+
+#endif
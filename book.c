@@ -0,0 +1,104 @@
+#include "book.h"
+
+/* Opening book: best moves for the first BOOK_PLIES plies, precomputed by
+ * gen_book up to symmetry and compiled in as OPENING_BOOK. Without it the
+ * book is empty and every lookup misses. */
+
+#ifdef OPENING_BOOK
+#include OPENING_BOOK
+#else
+#define BOOK_SIZE 0
+static const book_entry_t opening_book[1] = {{0}};
+#endif
+
+/**=================================SYMMETRY=================================**/
+
+/* Maps square by symmetry sym: a transpose if bit 0, then row and column
+    flips for bits 1 and 2 */
+int sym_square(int square, int sym) {
+    int row = SQUARE_ROW(square), col = SQUARE_COL(square), tmp;
+    if (sym & 1) {
+        tmp = row;
+        row = col;
+        col = tmp;
+    }
+    if (sym & 2) row = ROWS - 1 - row;
+    if (sym & 4) col = COLS - 1 - col;
+    return SQUARE(row, col);
+}
+
+/* Undoes sym_square(square, sym) */
+int unsym_square(int square, int sym) {
+    int row = SQUARE_ROW(square), col = SQUARE_COL(square), tmp;
+    if (sym & 4) col = COLS - 1 - col;
+    if (sym & 2) row = ROWS - 1 - row;
+    if (sym & 1) {
+        tmp = row;
+        row = col;
+        col = tmp;
+    }
+    return SQUARE(row, col);
+}
+
+/* Returns key with every square of its window mapped by sym */
+static pos_key_t sym_key(pos_key_t key, int sym) {
+    pos_key_t out = key & ~WINDOW_MASK;
+    int slot;
+    for (slot = 0; slot < MAX_MOVES; slot++) {
+        int stored = KEY_SLOT(key, slot);
+        if (stored == 0) continue;
+        out |= (pos_key_t)(sym_square(stored - 1, sym) + 1) << (slot*SQ_BITS);
+    }
+    return out;
+}
+
+/* Returns the least key over the symmetries of key, and in sym the symmetry
+    mapping key to it */
+pos_key_t canonical_key(pos_key_t key, int *sym) {
+    pos_key_t best = key, tmp;
+    int i;
+    *sym = 0;
+    for (i = 1; i < NUM_SYMMETRIES; i++) {
+        tmp = sym_key(key, i);
+        if (tmp < best) {
+            best = tmp;
+            *sym = i;
+        }
+    }
+    return best;
+}
+
+/**==================================LOOKUP==================================**/
+
+/* Finds the book entry of the position key, binary searching on its
+    canonical key; NULL if not booked */
+const book_entry_t *book_lookup(pos_key_t key, int *sym) {
+    if (BOOK_SIZE == 0) return NULL;
+    pos_key_t canon = canonical_key(key, sym);
+    int low = 0, high = BOOK_SIZE - 1;
+    while (low <= high) {
+        int mid = (low + high)/2;
+        if (opening_book[mid].key == canon) return &opening_book[mid];
+        if (opening_book[mid].key < canon) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+/* Writes the booked best child of parent into best, materialising parent's
+    children if needed; returns FALSE if parent is not booked */
+int book_move(turn_t *parent, best_child_t *best) {
+    assert(parent);
+    int sym;
+    const book_entry_t *entry = book_lookup(parent->key, &sym);
+    if (entry == NULL) return FALSE;
+    int square = unsym_square(entry->square, sym);
+    complete_children(parent);
+    best->best = find_child(parent, SQUARE_ROW(square), SQUARE_COL(square));
+    assert(best->best);
+    best->depth = entry->dist + 1;
+    return TRUE;
+}
@@ -0,0 +1,38 @@
+#ifndef _BOOK
+#define _BOOK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "game_struct.h"
+
+#ifndef BOOK_PLIES
+#define BOOK_PLIES 5        /* Positions with fewer moves made are booked */
+#endif
+#ifndef BOOK_DEPTH
+#define BOOK_DEPTH 16       /* Generation depth the book is searched at */
+#endif
+#define NUM_SYMMETRIES 8    /* Rotations and reflections of the board */
+
+#if BOOK_PLIES > MAX_MOVES
+#error "BOOK_PLIES must not exceed MAX_MOVES, so booked keys are unique"
+#endif
+
+/* Best move from a position, in the frame of its canonical key */
+typedef struct {
+    pos_key_t key;
+    unsigned char square;   /* Square of the best child */
+    unsigned char state;    /* BOOK_WIN or BOOK_BAD if that child is proven */
+    unsigned short dist;    /* If so, its dist */
+} book_entry_t;
+
+#define BOOK_WIN 1
+#define BOOK_BAD 2
+
+int sym_square(int square, int sym);
+int unsym_square(int square, int sym);
+pos_key_t canonical_key(pos_key_t key, int *sym);
+const book_entry_t *book_lookup(pos_key_t key, int *sym);
+int book_move(turn_t *parent, best_child_t *best);
+
+#endif
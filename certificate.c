@@ -0,0 +1,148 @@
+#include "certificate.h"
+
+/* Proof certificates: the part of a generated tree that proves a turn won,
+ * cut down to one reply per turn of the winner and every reply of the other
+ * players, written as the winner's squares alone. verify_cert.c checks one
+ * in a single streaming pass, with its own rules and none of this engine. */
+
+/**=================================MEASURING================================**/
+
+/* Checks if the player writing residue attacker moves next after turn */
+static int attacker_to_move(turn_t *turn, int attacker) {
+    return (turn->move.entry + 1) % BASE == attacker;
+}
+
+static int measure_proof(turn_t *turn, int attacker, proof_size_t *size);
+
+/* Returns the attacker's child of turn with the smallest proof, fewest
+    turns then fewest plies, with its size; NULL if the tree holds none */
+static turn_t *choose_child(turn_t *turn, int attacker, proof_size_t *size) {
+    turn_t *best = NULL;
+    proof_size_t child_size;
+    int i;
+    for (i = 0; i < turn->num_children; i++) {
+        turn_t *child = turn->children[i];
+        if (!child->win_state ||
+                !measure_proof(child, attacker, &child_size)) {
+            continue;
+        }
+        if (best == NULL || child_size.turns < size->turns ||
+                (child_size.turns == size->turns &&
+                child_size.plies < size->plies)) {
+            best = child;
+            *size = child_size;
+        }
+    }
+    return best;
+}
+
+/* Checks if the tree below turn proves that attacker wins, and if so gives
+    the size of the smallest such proof. Every reply of the other players
+    must be in the tree; a repeat or the frontier proves nothing */
+static int measure_proof(turn_t *turn, int attacker, proof_size_t *size) {
+    size->turns = size->choices = size->plies = 0;
+    if (turn->num_children == 0) {
+        return turn->win_state && turn->move.entry % BASE == attacker;
+    }
+    if (attacker_to_move(turn, attacker)) {
+        if (choose_child(turn, attacker, size) == NULL) return FALSE;
+        size->turns++;
+        size->choices++;
+        size->plies++;
+        return TRUE;
+    }
+    unsigned char square_stor[NUM_SQUARES];
+    int count, i;
+    empty_squares(key_occupied(turn->key), &count, square_stor);
+    if (turn->num_children != count) return FALSE;
+    proof_size_t child_size;
+    for (i = 0; i < turn->num_children; i++) {
+        if (!measure_proof(turn->children[i], attacker, &child_size)) {
+            return FALSE;
+        }
+        size->turns += child_size.turns;
+        size->choices += child_size.choices;
+        if (child_size.plies > size->plies) size->plies = child_size.plies;
+    }
+    size->turns += turn->num_children;
+    size->plies++;
+    return TRUE;
+}
+
+/**=================================WRITING==================================**/
+
+/* Writes the attacker's squares of the smallest proof below turn, depth
+    first, taking the other players' replies in ascending square order */
+static void write_proof(turn_t *turn, int attacker, FILE *fp) {
+    if (turn->num_children == 0) return;
+    if (attacker_to_move(turn, attacker)) {
+        proof_size_t size;
+        turn_t *best = choose_child(turn, attacker, &size);
+        assert(best);
+        putc(SQUARE(best->move.row, best->move.col), fp);
+        write_proof(best, attacker, fp);
+        return;
+    }
+    turn_t *by_square[NUM_SQUARES] = {NULL};
+    int i;
+    for (i = 0; i < turn->num_children; i++) {
+        turn_t *child = turn->children[i];
+        by_square[SQUARE(child->move.row, child->move.col)] = child;
+    }
+    for (i = 0; i < NUM_SQUARES; i++) {
+        if (by_square[i] != NULL) write_proof(by_square[i], attacker, fp);
+    }
+}
+
+/* Writes a certificate to path proving the decided turn won, by its mover
+    if a WIN or by the next player if BAD, and prints its size; returns
+    FALSE if turn is undecided, the tree lacks a full proof, or path cannot
+    be written */
+int export_certificate(turn_t *turn, const char *path) {
+    assert(turn);
+    if (!turn->win_state && !turn->bad_state) return FALSE;
+    int attacker = turn->win_state ? turn->move.entry % BASE :
+            (turn->move.entry + 1) % BASE;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    proof_size_t size;
+    if (turn->move.entry >= CERT_MAX_PLY ||
+            !measure_proof(turn, attacker, &size) ||
+            turn->move.entry + size.plies >= CERT_MAX_PLY) {
+        return FALSE;
+    }
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) return FALSE;
+    setvbuf(fp, NULL, _IOFBF, CERT_BUFFER);
+
+    /* Zeroed padding and all, so the same proof writes the same bytes */
+    cert_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CERT_MAGIC;
+    header.version = CERT_VERSION;
+    header.board_size = BOARD_SIZE;
+    header.line_len = LINE_LEN;
+    header.max_moves = MAX_MOVES;
+    header.base = BASE;
+    header.attacker = attacker;
+    header.history = turn->move.entry;
+    header.plies = size.plies;
+    header.turns = size.turns;
+    header.choices = size.choices;
+    fwrite(&header, sizeof(header), 1, fp);
+    unsigned char history[CERT_MAX_PLY];
+    turn_t *tmp;
+    for (tmp = turn; tmp->parent != NULL; tmp = tmp->parent) {
+        history[tmp->move.entry - 1] = SQUARE(tmp->move.row, tmp->move.col);
+    }
+    fwrite(history, 1, header.history, fp);
+    write_proof(turn, attacker, fp);
+    if (fclose(fp) != 0) return FALSE;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("Certificate: player %d wins within %d plies; %lld turns, "
+            "%lld bytes of choices, written in %.3fs\n",
+            attacker ? attacker : BASE, size.plies, size.turns, size.choices,
+            (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)*1e-9);
+    return TRUE;
+}
@@ -0,0 +1,40 @@
+#ifndef _CERTIFICATE
+#define _CERTIFICATE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "game_struct.h"
+
+#define CERT_MAGIC 0x4350454fu      /* "OEPC" */
+#define CERT_VERSION 1
+#define CERT_BUFFER (1 << 16)       /* Bytes buffered per read or write */
+#define CERT_MAX_PLY 1024           /* Deepest game a certificate may reach */
+#define CERT_MAX_BOARD 8            /* Largest board the verifier takes */
+
+/* Certificate header, holding its own rules so the verifier needs no build
+ * of them. The squares of the history, the moves from the empty board to
+ * the proven turn, follow; then one square per choice of the attacker, the
+ * player proven to win, in depth-first order. The other players' replies
+ * are not stored: every legal one is taken, in ascending square order. */
+typedef struct {
+    unsigned int magic, version;
+    int board_size, line_len, max_moves, base;
+    int attacker;           /* Residue of the entries the winner writes */
+    int history;            /* Plies from the empty board */
+    int plies;              /* Plies to the slowest win the proof allows */
+    long long turns;        /* Turns in the proof, below its root */
+    long long choices;      /* Attacker squares stored */
+} cert_header_t;
+
+/* Size of the smallest proof found below a turn */
+typedef struct {
+    long long turns, choices;
+    int plies;
+} proof_size_t;
+
+int export_certificate(turn_t *turn, const char *path);
+
+#endif
@@ -0,0 +1,224 @@
+#include "checkpoint.h"
+
+/* Checkpoints of a generation run: the tree is dumped in preorder, five bytes
+ * per turn, since moves' entries and keys follow from their parents. Dumps
+ * are taken by a forked child writing its copy-on-write snapshot, so
+ * generation only pauses for the fork. Files are replaced atomically. */
+
+/* Child process writing the latest checkpoint, if any */
+static pid_t writer_pid = -1;
+
+/**=================================WRITING==================================**/
+
+/* Unbuffered output used by the forked writer, which must avoid stdio */
+typedef struct {
+    int fd;
+    int used;
+    int failed;
+    long long num_nodes;
+    char *data;
+} dump_t;
+
+/* Writes out the buffered bytes of dump */
+static void dump_flush(dump_t *dump) {
+    int done = 0;
+    while (done < dump->used) {
+        ssize_t num = write(dump->fd, dump->data + done, dump->used - done);
+        if (num <= 0) {
+            dump->failed = TRUE;
+            break;
+        }
+        done += num;
+    }
+    dump->used = 0;
+}
+
+/* Appends num bytes to dump */
+static void dump_bytes(dump_t *dump, const void *bytes, int num) {
+    if (dump->used + num > CHECKPOINT_BUFFER) dump_flush(dump);
+    memcpy(dump->data + dump->used, bytes, num);
+    dump->used += num;
+}
+
+/* Dumps turn and everything below it in preorder */
+static void dump_turn(dump_t *dump, turn_t *turn) {
+    unsigned char node[NODE_BYTES];
+    node[0] = (turn->move.entry == EMPTY) ? NO_SQUARE :
+            SQUARE(turn->move.row, turn->move.col);
+    node[1] = (turn->win_state ? STATE_WIN : 0) |
+            (turn->bad_state ? STATE_BAD : 0) |
+            (turn->repeat_state ? STATE_REPEAT : 0);
+    node[2] = turn->dist & 0xff;
+    node[3] = (turn->dist >> 8) & 0xff;
+    node[4] = turn->num_children;
+    dump_bytes(dump, node, NODE_BYTES);
+    dump->num_nodes++;
+    int i;
+    for (i = 0; i < turn->num_children; i++) {
+        dump_turn(dump, turn->children[i]);
+    }
+}
+
+/* Writes the tree at root to path via a temporary file renamed over it;
+    returns FALSE on failure. Uses no stdio or malloc, so is fork-safe */
+int save_checkpoint(turn_t *root, int layers_done, const char *path) {
+    assert(root);
+    static char buffer[CHECKPOINT_BUFFER];
+    char tmp_path[CHECKPOINT_PATH_LEN];
+    int len = strlen(path);
+    if (len + 5 > CHECKPOINT_PATH_LEN) return FALSE;
+    memcpy(tmp_path, path, len);
+    memcpy(tmp_path + len, ".tmp", 5);
+
+    dump_t dump = {.fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644),
+            .used = 0, .failed = FALSE, .num_nodes = 0, .data = buffer};
+    if (dump.fd < 0) return FALSE;
+    /* Zeroed padding and all, so no stack bytes reach the file */
+    checkpoint_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.board_size = BOARD_SIZE;
+    header.line_len = LINE_LEN;
+    header.max_moves = MAX_MOVES;
+    header.base = BASE;
+    header.layers_done = layers_done;
+    dump_bytes(&dump, &header, sizeof(header));
+    dump_turn(&dump, root);
+    dump_flush(&dump);
+
+    /* Node count is only known now; patch it into the header */
+    header.num_nodes = dump.num_nodes;
+    if (pwrite(dump.fd, &header, sizeof(header), 0) != sizeof(header)) {
+        dump.failed = TRUE;
+    }
+    if (fsync(dump.fd) != 0) dump.failed = TRUE;
+    close(dump.fd);
+    if (dump.failed) return FALSE;
+    return rename(tmp_path, path) == 0;
+}
+
+/* Snapshots the tree in a forked child that writes it while the caller goes
+    on generating; waits for the previous snapshot first */
+void checkpoint_async(turn_t *root, int layers_done, const char *path) {
+    checkpoint_wait();
+    fflush(stdout);
+    writer_pid = fork();
+    if (writer_pid == 0) {
+        _exit(save_checkpoint(root, layers_done, path) ? EXIT_SUCCESS :
+                EXIT_FAILURE);
+    } else if (writer_pid < 0) {
+        /* No child to write it; fall back to writing in place */
+        if (!save_checkpoint(root, layers_done, path)) {
+            fprintf(stderr, "Checkpoint to %s failed\n", path);
+        }
+    }
+}
+
+/* Waits for the outstanding snapshot, reporting if it failed */
+void checkpoint_wait(void) {
+    if (writer_pid <= 0) return;
+    int status;
+    if (waitpid(writer_pid, &status, 0) == writer_pid &&
+            (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        fprintf(stderr, "Checkpoint writer failed\n");
+    }
+    writer_pid = -1;
+}
+
+/**=================================READING==================================**/
+
+/* Rebuilds turn from the next preorder record in fp, with its subtree */
+static int load_turn(FILE *fp, turn_t *turn) {
+    unsigned char node[NODE_BYTES];
+    if (fread(node, NODE_BYTES, 1, fp) != 1) return FALSE;
+    if (turn->parent != NULL) {
+        if (node[0] >= NUM_SQUARES) return FALSE;
+        turn->move = (move_t){
+            .row = SQUARE_ROW(node[0]),
+            .col = SQUARE_COL(node[0]),
+            .entry = next_move(turn->parent)
+        };
+        turn->key = child_key(turn->parent->key, node[0], turn->move.entry);
+    }
+    turn->win_state = (node[1] & STATE_WIN) ? TRUE : FALSE;
+    turn->bad_state = (node[1] & STATE_BAD) ? TRUE : FALSE;
+    turn->repeat_state = (node[1] & STATE_REPEAT) ? TRUE : FALSE;
+    turn->dist = node[2] | (node[3] << 8);
+    /* Counted only once the array holds them, so free_tree can always
+       clean up after a bad record */
+    int num_children = node[4];
+    if (num_children > NUM_SQUARES) return FALSE;
+    if (num_children == 0) return TRUE;
+
+    turn->children = alloc_children(num_children);
+    int i;
+    for (i = 0; i < num_children; i++) {
+        turn->children[i] = make_empty_turn();
+        turn->children[i]->parent = turn;
+    }
+    turn->num_children = num_children;
+    for (i = 0; i < turn->num_children; i++) {
+        if (!load_turn(fp, turn->children[i])) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Loads the tree checkpointed at path and the layers it had generated;
+    returns NULL if there is no usable checkpoint */
+turn_t *load_checkpoint(const char *path, int *layers_done) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return NULL;
+    checkpoint_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+            header.magic != CHECKPOINT_MAGIC ||
+            header.version != CHECKPOINT_VERSION ||
+            header.board_size != BOARD_SIZE || header.line_len != LINE_LEN ||
+            header.max_moves != MAX_MOVES || header.base != BASE) {
+        fprintf(stderr, "%s is not a checkpoint for these rules\n", path);
+        fclose(fp);
+        return NULL;
+    }
+    turn_t *root = make_empty_turn();
+    if (!load_turn(fp, root)) {
+        fprintf(stderr, "%s is truncated\n", path);
+        free_tree(root, TRUE);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *layers_done = header.layers_done;
+    return root;
+}
+
+/**================================GENERATION================================**/
+
+/* Generates depth layers from the empty board as generate_children does,
+    resuming from the checkpoint at path if there is one and checkpointing
+    there every CHECKPOINT_INTERVAL seconds and at the end */
+turn_t *generate_with_checkpoints(int depth, const char *path) {
+    assert(path);
+    int layers_done = 0;
+    turn_t *root = load_checkpoint(path, &layers_done);
+    if (root != NULL) {
+        printf("Resuming from %s after %d layers\n", path, layers_done);
+    } else {
+        root = make_empty_turn();
+    }
+
+    time_t last = time(NULL);
+    int unsaved = FALSE;
+    while (layers_done < depth) {
+        generate_children(root, 1);
+        layers_done++;
+        unsaved = TRUE;
+        if (time(NULL) - last >= CHECKPOINT_INTERVAL) {
+            checkpoint_async(root, layers_done, path);
+            last = time(NULL);
+            unsaved = FALSE;
+        }
+    }
+    if (unsaved) checkpoint_async(root, layers_done, path);
+    checkpoint_wait();
+    return root;
+}
@@ -0,0 +1,41 @@
+#ifndef _CHECKPOINT
+#define _CHECKPOINT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "game_struct.h"
+
+#define CHECKPOINT_MAGIC 0x50434f45u    /* "OECP" */
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_INTERVAL 60          /* Seconds between checkpoints */
+#define CHECKPOINT_BUFFER (1 << 20)
+#define CHECKPOINT_PATH_LEN 4096
+#define NO_SQUARE 0xff                  /* Stored as the root's move */
+
+/* Checkpoint file header; the tree follows in preorder, NODE_BYTES each */
+typedef struct {
+    unsigned int magic, version;
+    int board_size, line_len, max_moves, base;
+    int layers_done;
+    long long num_nodes;
+} checkpoint_header_t;
+
+#define NODE_BYTES 5    /* square, state bits, dist (2), num_children */
+#define STATE_WIN 1
+#define STATE_BAD 2
+#define STATE_REPEAT 4
+
+int save_checkpoint(turn_t *root, int layers_done, const char *path);
+void checkpoint_async(turn_t *root, int layers_done, const char *path);
+void checkpoint_wait(void);
+turn_t *load_checkpoint(const char *path, int *layers_done);
+turn_t *generate_with_checkpoints(int depth, const char *path);
+
+#endif
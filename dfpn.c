@@ -0,0 +1,218 @@
+#include "dfpn.h"
+
+/* Depth-first proof-number search (df-pn): proves or disproves that the
+ * player to move at a turn can force a win, expanding only the most
+ * proving branch under thresholds instead of every line. Proof and disproof
+ * numbers live in a transposition table of bounded size, so the search
+ * runs in fixed memory. The attacker moves at even distances from the
+ * start; repeats are draws, so count against it. */
+
+/**=================================NUMBERS==================================**/
+
+/* Adds proof or disproof numbers, saturating below DFPN_INF */
+static unsigned int dfpn_add(unsigned int a, unsigned int b) {
+    if (a == DFPN_INF || b == DFPN_INF) return DFPN_INF;
+    return (a + b < DFPN_INF) ? a + b : DFPN_INF - 1;
+}
+
+/* Checks if key at ply repeats a position of path, as is_repetition does */
+static int dfpn_repeats(pos_key_t key, int ply, pos_key_t path[]) {
+    int dist;
+    for (dist = MAX_MOVES; dist <= ply; dist++) {
+        if (dist % BASE == 0 && path[ply - dist] == key) return TRUE;
+    }
+    return FALSE;
+}
+
+/* Checks if the attacker is to move at ply */
+static int dfpn_or_node(dfpn_t *search, int ply) {
+    return (ply - search->start) % BASE == 0;
+}
+
+/* Finds the numbers of the turn at ply of the search path: exact for wins
+    and draws, else from the table, else 1 and 1 for an unexplored turn */
+static void dfpn_numbers(dfpn_t *search, int ply, unsigned int *pn,
+        unsigned int *dn) {
+    pos_key_t key = search->path[ply];
+    tt_hit_t hit;
+    if (mask_wins(key_mover(key))) {
+        /* The player who moved into this turn has won */
+        int attacker_won = !dfpn_or_node(search, ply);
+        *pn = attacker_won ? 0 : DFPN_INF;
+        *dn = attacker_won ? DFPN_INF : 0;
+    } else if (ply >= DFPN_MAX_PLY - 1 ||
+            dfpn_repeats(key, ply, search->path)) {
+        *pn = DFPN_INF;
+        *dn = 0;
+    } else if (tt_probe(search->tt, key, &hit)) {
+        *pn = hit.value >> 16;
+        *dn = hit.value & 0xffff;
+    } else {
+        *pn = *dn = 1;
+    }
+}
+
+/**==================================SEARCH==================================**/
+
+/* Expands the turn at ply until its proof number reaches th_pn or its
+    disproof number th_dn, always descending into the most proving child
+    with thresholds that return control once a sibling would be better */
+static void dfpn_mid(dfpn_t *search, int ply, unsigned int th_pn,
+        unsigned int th_dn) {
+    pos_key_t key = search->path[ply], child_keys[NUM_SQUARES];
+    unsigned char square_stor[NUM_SQUARES];
+    unsigned int pn = 1, dn = 1, c_pn, c_dn;
+    int i, count, or_node = dfpn_or_node(search, ply);
+    long long start_nodes = search->nodes++;
+    const unsigned char *squares = empty_squares(key_occupied(key), &count,
+            square_stor);
+    for (i = 0; i < count; i++) {
+        child_keys[i] = child_key(key, squares[i], ply + 1);
+    }
+
+    while (search->nodes < DFPN_MAX_NODES) {
+        /* OR: one proved child proves it; AND: every child must be */
+        unsigned int best = DFPN_INF, second = DFPN_INF;
+        unsigned int best_pn = 0, best_dn = 0;
+        int best_i = -1;
+        pn = or_node ? DFPN_INF : 0;
+        dn = or_node ? 0 : DFPN_INF;
+        for (i = 0; i < count; i++) {
+            search->path[ply+1] = child_keys[i];
+            dfpn_numbers(search, ply + 1, &c_pn, &c_dn);
+            unsigned int rank = or_node ? c_pn : c_dn;
+            if (or_node) {
+                if (c_pn < pn) pn = c_pn;
+                dn = dfpn_add(dn, c_dn);
+            } else {
+                pn = dfpn_add(pn, c_pn);
+                if (c_dn < dn) dn = c_dn;
+            }
+            if (best_i < 0 || rank < best) {
+                second = best;
+                best = rank;
+                best_i = i;
+                best_pn = c_pn;
+                best_dn = c_dn;
+            } else if (rank < second) {
+                second = rank;
+            }
+        }
+        if (count == 0) {
+            pn = DFPN_INF;
+            dn = 0;
+        }
+        if (pn >= th_pn || dn >= th_dn) break;
+
+        unsigned int child_th_pn, child_th_dn;
+        if (or_node) {
+            child_th_pn = (second < th_pn - 1) ? second + 1 : th_pn;
+            child_th_dn = (th_dn == DFPN_INF) ? DFPN_INF :
+                    th_dn - dn + best_dn;
+        } else {
+            child_th_dn = (second < th_dn - 1) ? second + 1 : th_dn;
+            child_th_pn = (th_pn == DFPN_INF) ? DFPN_INF :
+                    th_pn - pn + best_pn;
+        }
+        search->path[ply+1] = child_keys[best_i];
+        dfpn_mid(search, ply + 1, child_th_pn, child_th_dn);
+    }
+
+    /* Bigger searches claim their slot over smaller ones */
+    long long work = search->nodes - start_nodes;
+    tt_store(search->tt, key, (pn << 16) | dn, work < 0xffff ? work : 0xffff,
+            DFPN_TT_FLAG);
+}
+
+/* Counts the turns of the proof (or disproof) below the turn at ply: one
+    proving child of each OR turn and every child of each AND turn, or the
+    reverse for a disproof. As it rechecks repeats on the lines it walks,
+    a complete count also confirms the result despite the table ignoring
+    paths. Returns -1 if part of it is missing */
+static long long dfpn_proof_size(dfpn_t *search, int ply, int proof) {
+    unsigned int pn, dn;
+    dfpn_numbers(search, ply, &pn, &dn);
+    if ((proof ? pn : dn) != 0) return -1;
+    pos_key_t key = search->path[ply];
+    if (mask_wins(key_mover(key)) || ply >= DFPN_MAX_PLY - 1 ||
+            dfpn_repeats(key, ply, search->path)) {
+        return 1;
+    }
+    unsigned char square_stor[NUM_SQUARES];
+    int i, count, need_all = (dfpn_or_node(search, ply) != proof);
+    long long size = 1, child_size;
+    const unsigned char *squares = empty_squares(key_occupied(key), &count,
+            square_stor);
+    for (i = 0; i < count; i++) {
+        search->path[ply+1] = child_key(key, squares[i], ply + 1);
+        dfpn_numbers(search, ply + 1, &pn, &dn);
+        if ((proof ? pn : dn) != 0) {
+            if (need_all) return -1;
+            continue;
+        }
+        child_size = dfpn_proof_size(search, ply + 1, proof);
+        if (child_size < 0) {
+            if (need_all) return -1;
+            continue;
+        }
+        size += child_size;
+        if (!need_all) return size;
+    }
+    return need_all ? size : -1;
+}
+
+/* Proves or disproves that the player to move at path[ply] can force a win,
+    path holding the keys from the empty board down, with a table of
+    megabytes; prints the outcome, proof size and time and returns it */
+int dfpn_prove(pos_key_t path[], int ply, int megabytes) {
+    assert(ply >= 0 && ply < DFPN_MAX_PLY - 1);
+    if (BASE != 2) {
+        /* OR and AND nodes alternate only between two players */
+        printf("Proof-number search needs a two-player game\n");
+        return DFPN_UNKNOWN;
+    }
+    dfpn_t search = {.tt = make_tt(megabytes), .start = ply, .nodes = 0};
+    search.path = (pos_key_t*)malloc(DFPN_MAX_PLY*sizeof(pos_key_t));
+    assert(search.path);
+    memcpy(search.path, path, (ply + 1)*sizeof(pos_key_t));
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    dfpn_mid(&search, ply, DFPN_INF, DFPN_INF);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    tt_flush_stats(search.tt);
+
+    unsigned int pn, dn;
+    tt_hit_t hit;
+    pn = dn = 1;
+    if (tt_probe(search.tt, path[ply], &hit)) {
+        pn = hit.value >> 16;
+        dn = hit.value & 0xffff;
+    }
+    int outcome = (pn == 0) ? DFPN_PROVEN :
+            ((dn == 0) ? DFPN_DISPROVEN : DFPN_UNKNOWN);
+    if (outcome == DFPN_PROVEN) {
+        printf("Proved: the player to move can force a win\n");
+    } else if (outcome == DFPN_DISPROVEN) {
+        printf("Disproved: the player to move cannot force a win\n");
+    } else {
+        printf("Gave up after %lld expansions\n", search.nodes);
+    }
+    if (outcome != DFPN_UNKNOWN) {
+        long long size = dfpn_proof_size(&search, ply,
+                outcome == DFPN_PROVEN);
+        if (size < 0) {
+            printf("Proof tree: not rebuilt, as entries were evicted or "
+                    "reached through a repeat on another path; unconfirmed\n");
+        } else {
+            printf("Proof tree: %lld turns, checked along the actual lines\n",
+                    size);
+        }
+    }
+    printf("Expanded %lld turns in %.2fs\n", search.nodes,
+            (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)*1e-9);
+    tt_print_stats(search.tt);
+    free(search.path);
+    free_tt(search.tt);
+    return outcome;
+}
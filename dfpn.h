@@ -0,0 +1,35 @@
+#ifndef _DFPN
+#define _DFPN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include "game_struct.h"
+#include "tt.h"
+
+#define DFPN_INF 0xffff         /* Proof or disproof number of a lost cause */
+#define DFPN_MAX_PLY 4096       /* Deeper lines are cut as draws */
+#ifndef DFPN_MAX_NODES
+#define DFPN_MAX_NODES 100000000LL  /* Expansions before giving up */
+#endif
+#define DFPN_TT_FLAG 1
+#define DFPN_DEFAULT_MB 64      /* Table size for proofs asked for in play */
+
+/* State of one proof-number search, from the turn at path[start] */
+typedef struct {
+    tt_t *tt;
+    pos_key_t *path;
+    int start;
+    long long nodes;
+} dfpn_t;
+
+/* Outcome of a search */
+#define DFPN_PROVEN 1
+#define DFPN_DISPROVEN 2
+#define DFPN_UNKNOWN 0
+
+int dfpn_prove(pos_key_t path[], int ply, int megabytes);
+
+#endif
@@ -0,0 +1,245 @@
+#include "estimate.h"
+
+/* Tree-size estimation: random probes from the root, as in Knuth's estimator,
+ * predict how many turns generate_children would make at each depth, and a
+ * short timed generation turns those counts into memory and runtime. Memory
+ * is counted in the arena's size classes, without the slack of its last
+ * slab. */
+
+/**=================================PROBES===================================**/
+
+/* Returns wall clock seconds */
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+/* Checks if key at ply repeats a position of path, as is_repetition does */
+static int probe_repeats(pos_key_t key, int ply, pos_key_t path[]) {
+    int dist;
+    for (dist = MAX_MOVES; dist <= ply; dist++) {
+        if (dist % BASE == 0 && path[ply - dist] == key) return TRUE;
+    }
+    return FALSE;
+}
+
+/* Solves the turn at ply of path by searching horizon plies below it,
+    returning PROBE_WIN, PROBE_BAD or PROBE_OPEN as update_win_states and
+    update_bad_states would on a tree that deep; path grows as it searches */
+static int probe_solve(pos_key_t path[], int ply, int horizon) {
+    pos_key_t key = path[ply];
+    if (mask_wins(key_mover(key))) return PROBE_WIN;
+    if (horizon == 0 || probe_repeats(key, ply, path)) return PROBE_OPEN;
+    unsigned char square_stor[NUM_SQUARES];
+    int i, count, all_bad = TRUE;
+    const unsigned char *squares = empty_squares(key_occupied(key), &count,
+            square_stor);
+    if (count == 0) return PROBE_OPEN;
+    for (i = 0; i < count; i++) {
+        path[ply+1] = child_key(key, squares[i], ply + 1);
+        int state = probe_solve(path, ply + 1, horizon - 1);
+        if (state == PROBE_WIN) return PROBE_BAD;
+        if (state != PROBE_BAD) all_bad = FALSE;
+    }
+    return all_bad ? PROBE_WIN : PROBE_OPEN;
+}
+
+/* Checks if the turn at ply of path would be expanded by the layer after
+    it: it and every ancestor but the root must still be undecided on the
+    tree generated so far, searched at most PROBE_HORIZON plies deep on a
+    scratch copy of path */
+static int probe_open(pos_key_t path[], pos_key_t scratch[], int ply) {
+    int level;
+    memcpy(scratch, path, (ply + 1)*sizeof(pos_key_t));
+    for (level = ply; level > 0 && ply - level <= PROBE_HORIZON; level--) {
+        if (probe_solve(scratch, level, ply - level) != PROBE_OPEN) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* Walks one random path from the frontier turn at ply of path as deep as
+    generate_children would grow it, multiplying weight by the branching
+    factor at each ply and adding the result to turns[ply]. Averaged over
+    probes this is Knuth's unbiased estimate of the turns at each ply, but
+    for turns decided only by searching deeper than PROBE_HORIZON, which are
+    still walked below, so counts run somewhat high */
+static void probe(int ply, int depth, double weight, pos_key_t path[],
+        pos_key_t scratch[], double turns[], unsigned int *seed) {
+    unsigned char square_stor[NUM_SQUARES];
+    int count;
+    for (; ply < depth; ply++) {
+        if (!probe_open(path, scratch, ply)) break;
+        if (probe_repeats(path[ply], ply, path)) break;
+        const unsigned char *squares = empty_squares(key_occupied(path[ply]),
+                &count, square_stor);
+        if (count == 0) break;
+        weight *= count;
+        turns[ply+1] += weight;
+        path[ply+1] = child_key(path[ply], squares[rand_r(seed) % count],
+                ply + 1);
+    }
+}
+
+/* Adds one probe's value to a running estimate */
+static void add_sample(estimate_t *est, double value) {
+    est->sum += value;
+    est->sum_sq += value*value;
+}
+
+/* Returns the mean of an estimate over num probes, with its 95% half-width */
+static double sample_mean(estimate_t *est, long num, double *half_width) {
+    double mean = est->sum/num;
+    double var = (est->sum_sq/num - mean*mean)*num/(num > 1 ? num - 1 : 1);
+    *half_width = Z_95*sqrt(var > 0 ? var/num : 0);
+    return mean;
+}
+
+/**===============================EXACT PREFIX===============================**/
+
+/* Counts the turns of the tree at parent by ply into counts, and collects
+    into frontier the turns at ply that the next layer would expand */
+static void scan_prefix(turn_t *parent, int level, int ply, int open,
+        double counts[], turn_t **frontier, long *num_frontier) {
+    counts[level]++;
+    if (level > 0 && (parent->win_state || parent->bad_state)) open = FALSE;
+    if (parent->repeat_state) open = FALSE;
+    if (level == ply) {
+        if (open && frontier) frontier[(*num_frontier)++] = parent;
+        else if (open) (*num_frontier)++;
+        return;
+    }
+    int i;
+    for (i = 0; i < parent->num_children; i++) {
+        scan_prefix(parent->children[i], level + 1, ply, open, counts,
+                frontier, num_frontier);
+    }
+}
+
+/* Generates the real tree layer by layer for about CALIBRATE_SECONDS, at
+    most depth deep and stopping before a layer could pass PREFIX_MAX_TURNS;
+    returns it with its depth in ply, its turns by ply in counts and the
+    seconds per turn visited in per_visit. Each layer walks the whole tree
+    grown so far, so costs about the turns in it after */
+static turn_t *generate_prefix(int depth, int *ply, double counts[],
+        double *per_visit) {
+    turn_t *root = make_empty_turn();
+    assert(root);
+    double start = now_seconds(), elapsed = 0, visits = 0;
+    long num_frontier = 1;
+    int i;
+    for (*ply = 0; *ply < depth && elapsed < CALIBRATE_SECONDS &&
+            num_frontier*NUM_SQUARES <= PREFIX_MAX_TURNS; (*ply)++) {
+        generate_children(root, 1);
+        for (i = 0; i <= *ply + 1; i++) counts[i] = 0;
+        num_frontier = 0;
+        scan_prefix(root, 0, *ply + 1, TRUE, counts, NULL, &num_frontier);
+        for (i = 0; i <= *ply + 1; i++) visits += counts[i];
+        elapsed = now_seconds() - start;
+    }
+    *per_visit = visits ? elapsed/visits : 0;
+    return root;
+}
+
+/* Fills path with the keys from the root down to turn at ply */
+static void prefix_path(turn_t *turn, int ply, pos_key_t path[]) {
+    for (; ply >= 0; ply--) {
+        path[ply] = turn->key;
+        turn = turn->parent;
+    }
+}
+
+/**=================================REPORT===================================**/
+
+/* Prints predicted turns, memory and generation time for every depth up to
+    depth, each with a 95% confidence interval. The first plies are counted
+    exactly on a real generation, which also times it; random probes from
+    its frontier estimate the rest */
+void estimate_tree(int depth) {
+    assert(depth >= 0);
+    if (BASE != 2) {
+        /* probe_solve decides turns as a two-player game */
+        printf("Estimation needs a two-player game\n");
+        return;
+    }
+    double *counts = (double*)calloc(depth + 2, sizeof(double));
+    double *turns = (double*)malloc((depth + 1)*sizeof(double));
+    pos_key_t *path = (pos_key_t*)malloc((depth + 1)*sizeof(pos_key_t));
+    pos_key_t *scratch = (pos_key_t*)malloc((depth + PROBE_HORIZON + 1)*
+            sizeof(pos_key_t));
+    estimate_t *layer = (estimate_t*)calloc(depth + 1, sizeof(estimate_t));
+    estimate_t *total = (estimate_t*)calloc(depth + 1, sizeof(estimate_t));
+    estimate_t *visits = (estimate_t*)calloc(depth + 1, sizeof(estimate_t));
+    assert(counts && turns && path && scratch && layer && total && visits);
+
+    int prefix_ply, i, ply;
+    double per_visit;
+    turn_t *root = generate_prefix(depth, &prefix_ply, counts, &per_visit);
+    long num_frontier = 0;
+    turn_t **frontier = (turn_t**)malloc((counts[prefix_ply] + 1)*
+            sizeof(turn_t*));
+    assert(frontier);
+    for (i = 0; i <= prefix_ply; i++) counts[i] = 0;
+    scan_prefix(root, 0, prefix_ply, TRUE, counts, frontier, &num_frontier);
+
+    /* Probe from random frontier turns in batches until the time is up */
+    unsigned int seed = (unsigned int)time(NULL);
+    double start = now_seconds();
+    long num_probes = 0;
+    do {
+        for (i = 0; i < ESTIMATE_BATCH; i++) {
+            for (ply = 0; ply <= depth; ply++) {
+                turns[ply] = (ply <= prefix_ply) ? counts[ply] : 0;
+            }
+            if (num_frontier) {
+                turn_t *start_turn = frontier[rand_r(&seed) % num_frontier];
+                prefix_path(start_turn, prefix_ply, path);
+                probe(prefix_ply, depth, num_frontier, path, scratch, turns,
+                        &seed);
+            }
+            double turns_so_far = 0, visits_so_far = 0;
+            for (ply = 0; ply <= depth; ply++) {
+                turns_so_far += turns[ply];
+                visits_so_far += turns_so_far;
+                add_sample(&layer[ply], turns[ply]);
+                add_sample(&total[ply], turns_so_far);
+                add_sample(&visits[ply], visits_so_far);
+            }
+        }
+        num_probes += ESTIMATE_BATCH;
+    } while (num_frontier && prefix_ply < depth &&
+            now_seconds() - start < ESTIMATE_SECONDS);
+    /* Each turn takes its size class in the arena and one pointer in its
+        parent's children array, which holds whole grains */
+    double turn_bytes = ARENA_BYTES(sizeof(turn_t)) + sizeof(turn_t*);
+
+    printf("Depths 0 to %d counted exactly, deeper estimated from %ld "
+            "random probes (95%% intervals of probe variance alone)\n",
+            prefix_ply, num_probes);
+    printf("%5s %24s %24s %12s %12s\n", "Depth", "Turns at depth",
+            "Turns in tree", "Memory (MB)", "Time (s)");
+    for (ply = 0; ply <= depth; ply++) {
+        double layer_hw, total_hw, visits_hw;
+        double layer_mean = sample_mean(&layer[ply], num_probes, &layer_hw);
+        double total_mean = sample_mean(&total[ply], num_probes, &total_hw);
+        double visits_mean = sample_mean(&visits[ply], num_probes,
+                &visits_hw);
+        printf("%5d %12.4g +- %-9.2g %12.4g +- %-9.2g %12.1f %12.2f\n", ply,
+                layer_mean, layer_hw, total_mean, total_hw,
+                total_mean*turn_bytes/(1 << 20),
+                (visits_mean - 1)*per_visit);
+    }
+    printf("Intervals leave out bias: counts run high where turns are "
+            "decided more than %d plies down\n", PROBE_HORIZON);
+    free_tree(root, TRUE);
+    free(frontier);
+    free(counts);
+    free(turns);
+    free(path);
+    free(scratch);
+    free(layer);
+    free(total);
+    free(visits);
+}
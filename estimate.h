@@ -0,0 +1,31 @@
+#ifndef _ESTIMATE
+#define _ESTIMATE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+#include "game_struct.h"
+
+#define ESTIMATE_SECONDS 0.5    /* Time spent on random probes */
+#define ESTIMATE_BATCH 256      /* Probes between clock checks */
+#define CALIBRATE_SECONDS 0.1   /* Time spent timing a real generation */
+#define PREFIX_MAX_TURNS (1 << 20)  /* Largest layer generated for real */
+#define Z_95 1.96               /* Normal quantile of a 95% interval */
+/* Plies searched to see if a turn is decided; deeper misses fewer cuts, but
+    costs about NUM_SQUARES times more per ply */
+#define PROBE_HORIZON (NUM_SQUARES <= 9 ? 6 : 4)
+#define PROBE_OPEN 0
+#define PROBE_WIN 1
+#define PROBE_BAD 2
+
+/* Running sums of one quantity over the probes */
+typedef struct {
+    double sum, sum_sq;
+} estimate_t;
+
+void estimate_tree(int depth);
+
+#endif
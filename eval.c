@@ -0,0 +1,275 @@
+#include "eval.h"
+
+/* Static evaluation: past the generated tree every undecided turn looks
+ * alike, so a shallow alpha-beta search over position keys scores them by
+ * a weighted sum of line features instead. The features are counted with
+ * masks and popcounts, without branches, and the weights come from
+ * tune_weights, which plays candidate weights against each other. */
+
+/* Tuned by tune_weights on the standard game, in EVAL_* feature order */
+static const int default_weights[EVAL_FEATURES] = {
+    42, 21, -38, 27, 14, -30, 38
+};
+
+/* Plies searched past the tree to order undecided turns, 0 if off */
+static int search_depth = 0;
+
+/**================================FEATURES==================================**/
+
+/* Returns the mask of the central squares: the middle one or four */
+static mask_t centre_mask(void) {
+    mask_t mask = 0;
+    int sq;
+    for (sq = 0; sq < NUM_SQUARES; sq++) {
+        int row = 2*SQUARE_ROW(sq) - (ROWS - 1);
+        int col = 2*SQUARE_COL(sq) - (COLS - 1);
+        if (row >= -1 && row <= 1 && col >= -1 && col <= 1) {
+            mask |= 1u << sq;
+        }
+    }
+    return mask;
+}
+
+/* Returns the mask of tiles that vanish within the next round of moves,
+    i.e. those in the oldest BASE slots of key's window */
+static mask_t fading_tiles(pos_key_t key) {
+    mask_t mask = 0;
+    int slot;
+    for (slot = MAX_MOVES - BASE; slot < MAX_MOVES; slot++) {
+        int sq = KEY_SLOT(key, slot);
+        mask |= (mask_t)(sq != 0) << ((sq - 1) & 31);
+    }
+    return mask;
+}
+
+/* Scores key for the player who just moved, as the dot product of weights
+    with the EVAL_* features */
+int eval_key(pos_key_t key, const int weights[]) {
+    int num_lines, i, f[EVAL_FEATURES] = {0};
+    const mask_t *lines = win_lines(&num_lines);
+    mask_t own = key_mover(key), their = key_occupied(key) & ~own;
+    mask_t fading = fading_tiles(key), centre = centre_mask();
+    for (i = 0; i < num_lines; i++) {
+        mask_t line = lines[i];
+        int num_own = __builtin_popcount(own & line);
+        int num_their = __builtin_popcount(their & line);
+        int own_open = (num_their == 0), their_open = (num_own == 0);
+        int own_threat = own_open & (num_own == LINE_LEN - 1);
+        int their_threat = their_open & (num_their == LINE_LEN - 1);
+        f[EVAL_OWN_THREATS] += own_threat;
+        f[EVAL_OWN_OPEN] += (own_open & !own_threat)*num_own;
+        f[EVAL_THEIR_THREATS] += their_threat;
+        f[EVAL_THEIR_OPEN] += (their_open & !their_threat)*num_their;
+        f[EVAL_OWN_FADING] += own_threat & ((own & fading & line) != 0);
+        f[EVAL_THEIR_FADING] += their_threat & ((their & fading & line) != 0);
+    }
+    f[EVAL_CENTRE] = __builtin_popcount(own & centre) -
+            __builtin_popcount(their & centre);
+    int score = 0;
+    for (i = 0; i < EVAL_FEATURES; i++) score += weights[i]*f[i];
+    return score;
+}
+
+/* Returns the weights used outside tuning */
+const int *eval_weights(void) {
+    return default_weights;
+}
+
+/**==================================SEARCH==================================**/
+
+/* Checks if key at ply repeats a position of path, as is_repetition does */
+static int eval_repeats(pos_key_t key, int ply, pos_key_t path[]) {
+    int dist;
+    for (dist = MAX_MOVES; dist <= ply; dist++) {
+        if (dist % BASE == 0 && path[ply - dist] == key) return TRUE;
+    }
+    return FALSE;
+}
+
+/* Scores the turn at ply of path for the player to move by alpha-beta
+    search depth plies deep, scoring the horizon with eval_key. Wins score
+    EVAL_WIN less their ply, so faster ones score higher; repeats draw */
+int eval_search(pos_key_t path[], int ply, int depth, int alpha, int beta,
+        const int weights[]) {
+    pos_key_t key = path[ply];
+    if (ply > 0 && mask_wins(key_mover(key))) return -(EVAL_WIN - ply);
+    if (ply > 0 && eval_repeats(key, ply, path)) return 0;
+    if (depth == 0 || ply >= EVAL_MAX_PLY - 1) return -eval_key(key, weights);
+    unsigned char square_stor[NUM_SQUARES];
+    int i, count, best = -EVAL_INF;
+    const unsigned char *squares = empty_squares(key_occupied(key), &count,
+            square_stor);
+    if (count == 0) return 0;
+    for (i = 0; i < count; i++) {
+        path[ply+1] = child_key(key, squares[i], ply + 1);
+        int score = -eval_search(path, ply + 1, depth - 1, -beta, -alpha,
+                weights);
+        if (score > best) best = score;
+        if (best > alpha) alpha = best;
+        if (alpha >= beta) break;
+    }
+    return best;
+}
+
+/* Sets the plies eval_best_child searches, 0 to leave best_child alone */
+void set_eval_depth(int depth) {
+    search_depth = depth;
+}
+
+/* Refines best, best_child's choice at parent: if that is undecided, the
+    undecided child scoring highest by eval_search is chosen instead */
+best_child_t eval_best_child(turn_t *parent, best_child_t best) {
+    assert(parent);
+    if (search_depth <= 0 || best.best == NULL || best.best->win_state ||
+            best.best->bad_state) {
+        return best;
+    }
+    int ply = parent->move.entry, i;
+    if (ply + search_depth + 1 >= EVAL_MAX_PLY) return best;
+    pos_key_t *path = (pos_key_t*)malloc((ply + search_depth + 2)*
+            sizeof(pos_key_t));
+    assert(path);
+    turn_t *tmp = parent;
+    for (i = ply; i >= 0; i--) {
+        path[i] = tmp->key;
+        tmp = tmp->parent;
+    }
+    int alpha = -EVAL_INF;
+    for (i = 0; i < parent->num_children; i++) {
+        turn_t *child = parent->children[i];
+        if (child->win_state || child->bad_state) continue;
+        path[ply+1] = child->key;
+        int score = -eval_search(path, ply + 1, search_depth - 1, -EVAL_INF,
+                -alpha, eval_weights());
+        if (score > alpha) {
+            alpha = score;
+            best.best = child;
+        }
+    }
+    free(path);
+    return best;
+}
+
+/**==================================TUNING==================================**/
+
+/* Plays one game from the opening in path[0] to path[ply], each move
+    searched TUNE_DEPTH plies with first's weights on odd entries and
+    second's on even ones; returns 1 if first wins, -1 if second does and
+    0 for a draw by length */
+static int play_game(pos_key_t path[], int ply, const int *first,
+        const int *second) {
+    unsigned char square_stor[NUM_SQUARES];
+    int i, count;
+    for (; ply < TUNE_MAX_PLIES; ply++) {
+        pos_key_t key = path[ply];
+        if (ply > 0 && mask_wins(key_mover(key))) return (ply % 2) ? 1 : -1;
+        const int *weights = (ply % 2) ? second : first;
+        const unsigned char *squares = empty_squares(key_occupied(key),
+                &count, square_stor);
+        if (count == 0) return 0;
+        int best = -EVAL_INF, best_square = squares[0];
+        for (i = 0; i < count; i++) {
+            path[ply+1] = child_key(key, squares[i], ply + 1);
+            int score = -eval_search(path, ply + 1, TUNE_DEPTH - 1, -EVAL_INF,
+                    -best, weights);
+            if (score > best) {
+                best = score;
+                best_square = squares[i];
+            }
+        }
+        path[ply+1] = child_key(key, best_square, ply + 1);
+    }
+    return 0;
+}
+
+/* Worker body: plays pairs of games, each from a fresh random opening with
+    either side first, until the match is over */
+static void *match_worker(void *arg) {
+    match_t *match = (match_t*)arg;
+    pos_key_t path[TUNE_MAX_PLIES + TUNE_DEPTH + 1];
+    unsigned char square_stor[NUM_SQUARES];
+    int pair, ply, count;
+    while ((pair = atomic_fetch_add(&match->next_pair, 1)) < TUNE_GAMES/2) {
+        unsigned int seed = match->seed + pair;
+        pos_key_t opening[TUNE_OPENING + 1];
+        opening[0] = 0;
+        for (ply = 0; ply < TUNE_OPENING; ply++) {
+            const unsigned char *squares = empty_squares(
+                    key_occupied(opening[ply]), &count, square_stor);
+            opening[ply+1] = child_key(opening[ply],
+                    squares[rand_r(&seed) % count], ply + 1);
+        }
+        memcpy(path, opening, sizeof(opening));
+        int score = play_game(path, TUNE_OPENING, match->first,
+                match->second);
+        memcpy(path, opening, sizeof(opening));
+        score -= play_game(path, TUNE_OPENING, match->second, match->first);
+        atomic_fetch_add(&match->score, score);
+    }
+    return NULL;
+}
+
+/* Plays TUNE_GAMES games of weights a against b on every core; returns a's
+    wins less b's */
+static int play_match(const int *a, const int *b, unsigned int seed) {
+    match_t match = {.first = a, .second = b, .seed = seed};
+    atomic_init(&match.next_pair, 0);
+    atomic_init(&match.score, 0);
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN), t;
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > TUNE_MAX_THREADS) num_threads = TUNE_MAX_THREADS;
+    pthread_t threads[TUNE_MAX_THREADS];
+    for (t = 0; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, match_worker, &match) != 0) {
+            /* The threads started share out every game regardless */
+            fprintf(stderr, "Started only %d of %d threads\n", t,
+                    num_threads);
+            num_threads = t;
+            break;
+        }
+    }
+    if (num_threads == 0) match_worker(&match);
+    for (t = 0; t < num_threads; t++) pthread_join(threads[t], NULL);
+    return atomic_load(&match.score);
+}
+
+/* Prints weights as an initialiser for default_weights */
+static void print_weights(const int weights[]) {
+    int i;
+    printf("{");
+    for (i = 0; i < EVAL_FEATURES; i++) {
+        printf("%d%s", weights[i], (i < EVAL_FEATURES - 1) ? ", " : "}\n");
+    }
+}
+
+/* Tunes the weights by self-play for rounds rounds: each round perturbs
+    every weight by TUNE_STEP either way, plays the two opposite candidates
+    against each other and keeps the winner. Prints each round, then how
+    the result fares against the defaults */
+void tune_weights(int rounds) {
+    if (BASE != 2) {
+        /* eval_search is negamax over two sides */
+        printf("Tuning needs a two-player game\n");
+        return;
+    }
+    int weights[EVAL_FEATURES], plus[EVAL_FEATURES], minus[EVAL_FEATURES];
+    int round, i;
+    unsigned int seed = (unsigned int)time(NULL);
+    memcpy(weights, default_weights, sizeof(weights));
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < EVAL_FEATURES; i++) {
+            int delta = (rand_r(&seed) & 1) ? TUNE_STEP : -TUNE_STEP;
+            plus[i] = weights[i] + delta;
+            minus[i] = weights[i] - delta;
+        }
+        int score = play_match(plus, minus, rand_r(&seed));
+        if (score > 0) memcpy(weights, plus, sizeof(weights));
+        if (score < 0) memcpy(weights, minus, sizeof(weights));
+        printf("Round %d: %+d, weights ", round + 1, score);
+        print_weights(weights);
+    }
+    printf("Tuned against default over %d games: %+d\n", TUNE_GAMES,
+            play_match(weights, default_weights, rand_r(&seed)));
+    printf("Weights: ");
+    print_weights(weights);
+}
@@ -0,0 +1,51 @@
+#ifndef _EVAL
+#define _EVAL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "game_struct.h"
+
+/* Features of a position, each counted for the player who just moved */
+#define EVAL_OWN_THREATS 0      /* Open lines one tile short */
+#define EVAL_OWN_OPEN 1         /* Tiles in shorter open lines */
+#define EVAL_THEIR_THREATS 2    /* As above, for the player to move */
+#define EVAL_THEIR_OPEN 3
+#define EVAL_CENTRE 4           /* Own centre tiles less theirs */
+#define EVAL_OWN_FADING 5       /* Own threats losing a tile within a round */
+#define EVAL_THEIR_FADING 6
+#define EVAL_FEATURES 7
+
+#define EVAL_WIN 1000000        /* Score of a won game, less its plies */
+#define EVAL_INF (2*EVAL_WIN)
+#define EVAL_MAX_PLY 4096       /* Deeper lines are cut as draws */
+#define TUNE_DEPTH 2            /* Plies searched per move in tuning games */
+#define TUNE_GAMES 256          /* Games per tuning round, half each colour */
+#define TUNE_OPENING 2          /* Random plies opening each game pair */
+#define TUNE_MAX_PLIES 60       /* Longer games are drawn */
+#define TUNE_STEP 2             /* Weight perturbation per round */
+#define TUNE_MAX_THREADS 256
+
+/* Shared state of a tuning match: games are taken in pairs from one random
+ * opening, each side playing first once */
+typedef struct {
+    const int *first, *second;
+    unsigned int seed;
+    atomic_int next_pair;
+    atomic_int score;           /* Wins of first less wins of second */
+} match_t;
+
+int eval_key(pos_key_t key, const int weights[]);
+int eval_search(pos_key_t path[], int ply, int depth, int alpha, int beta,
+        const int weights[]);
+const int *eval_weights(void);
+void set_eval_depth(int depth);
+best_child_t eval_best_child(turn_t *parent, best_child_t best);
+void tune_weights(int rounds);
+
+#endif
@@ -0,0 +1,166 @@
+#include "freeze.h"
+
+/* Freezing a finished tree: every turn is moved into one buffer in van Emde
+ * Boas order, each subtree of half the height stored contiguously and
+ * recursively so, with the children arrays after the turns in the same
+ * order. A descent then touches O(log_B N) blocks for any block size B. */
+
+/* The buffer of the frozen tree, if any */
+static void *frozen = NULL;
+
+/**==================================LAYOUT==================================**/
+
+/* Counts the turns at root, and its height in turns */
+static long long measure(turn_t *root, int *height) {
+    long long count = 1;
+    int i, child_height;
+    *height = 1;
+    for (i = 0; i < root->num_children; i++) {
+        count += measure(root->children[i], &child_height);
+        if (child_height + 1 > *height) *height = child_height + 1;
+    }
+    return count;
+}
+
+static void veb_order(turn_t *root, int height, turn_t **order,
+        long long *num);
+
+/* Lays out every subtree rooted depth turns below root with height */
+static void veb_bottoms(turn_t *root, int depth, int height, turn_t **order,
+        long long *num) {
+    if (depth == 0) {
+        veb_order(root, height, order, num);
+        return;
+    }
+    int i;
+    for (i = 0; i < root->num_children; i++) {
+        veb_bottoms(root->children[i], depth - 1, height, order, num);
+    }
+}
+
+/* Appends the turns of root's subtree down to height turns deep to order:
+    the top half of the height first, then each bottom subtree, each laid
+    out the same way */
+static void veb_order(turn_t *root, int height, turn_t **order,
+        long long *num) {
+    if (height == 1) {
+        order[(*num)++] = root;
+        return;
+    }
+    int top = height/2;
+    veb_order(root, top, order, num);
+    veb_bottoms(root, top, height - top, order, num);
+}
+
+/* Moves the tree at root into one buffer in van Emde Boas order and frees
+    the old turns; returns the new root. Turns added later are allocated
+    as usual, while the frozen ones are only freed by free_frozen_tree */
+turn_t *freeze_tree(turn_t *root) {
+    assert(root);
+    assert(frozen == NULL);
+    int height;
+    long long n = measure(root, &height), num = 0, i, next_link = 0;
+    turn_t **order = (turn_t**)malloc(n*sizeof(turn_t*));
+    size_t size = n*sizeof(turn_t) + n*sizeof(turn_t*);
+    frozen = malloc(size);
+    assert(order && frozen);
+    veb_order(root, height, order, &num);
+    assert(num == n);
+
+    /* Copy, then leave each old turn's new address in its parent field */
+    turn_t *turns = (turn_t*)frozen;
+    turn_t **links = (turn_t**)(turns + n);
+    for (i = 0; i < n; i++) turns[i] = *order[i];
+    for (i = 0; i < n; i++) order[i]->parent = &turns[i];
+    for (i = 0; i < n; i++) {
+        turn_t *turn = &turns[i];
+        int j;
+        if (turn->parent != NULL) turn->parent = turn->parent->parent;
+        if (turn->num_children == 0) continue;
+        for (j = 0; j < turn->num_children; j++) {
+            links[next_link + j] = turn->children[j]->parent;
+        }
+        turn->children = &links[next_link];
+        next_link += turn->num_children;
+    }
+    /* The old turns go back to the arena */
+    for (i = 0; i < n; i++) free_turn(order[i]);
+    free(order);
+    set_frozen_buffer(frozen, size);
+    return &turns[0];
+}
+
+/* Frees the tree at root, frozen turns and all */
+void free_frozen_tree(turn_t *root) {
+    free_tree(root, TRUE);
+    release_frozen_buffer();
+}
+
+/* Frees the frozen buffer alone, for when the arena is released whole */
+void release_frozen_buffer(void) {
+    set_frozen_buffer(NULL, 0);
+    free(frozen);
+    frozen = NULL;
+}
+
+/**================================BENCHMARK=================================**/
+
+/* Orders doubles ascending */
+static int compare_times(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Returns nanoseconds from start to end */
+static double elapsed_ns(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec)*1e9 +
+            (end->tv_nsec - start->tv_nsec);
+}
+
+/* Returns the median cost of reading the clock twice, which each timed
+    descent carries */
+static double timer_overhead(void) {
+    double times[BENCH_CALIBRATE];
+    int i;
+    for (i = 0; i < BENCH_CALIBRATE; i++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        times[i] = elapsed_ns(&start, &end);
+    }
+    qsort(times, BENCH_CALIBRATE, sizeof(double), compare_times);
+    return times[BENCH_CALIBRATE/2];
+}
+
+/* Times random root to leaf descents, as play and best_child make, reading
+    each turn on the way, and prints the median and tail of single descents,
+    each timed on its own less the clock's overhead */
+void descent_benchmark(turn_t *root, const char *label) {
+    double *times = (double*)malloc(BENCH_DESCENTS*sizeof(double));
+    assert(times);
+    double overhead = timer_overhead();
+    unsigned int seed = 1;
+    long long visited = 0, steps = 0;
+    int i;
+    perf_start();
+    for (i = 0; i < BENCH_DESCENTS; i++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        turn_t *turn = root;
+        while (turn->num_children) {
+            visited += turn->win_state + turn->bad_state;
+            steps++;
+            turn = turn->children[rand_r(&seed) % turn->num_children];
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        times[i] = elapsed_ns(&start, &end) - overhead;
+        if (times[i] < 0) times[i] = 0;
+    }
+    perf_stop(frozen ? PHASE_FROZEN_DESCENTS : PHASE_HEAP_DESCENTS, steps);
+    qsort(times, BENCH_DESCENTS, sizeof(double), compare_times);
+    printf("%s descents: p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns "
+            "(%lld proven on the way, clock overhead %.0f ns)\n", label,
+            times[BENCH_DESCENTS/2], times[BENCH_DESCENTS*99/100],
+            times[BENCH_DESCENTS*999/1000], visited, overhead);
+    free(times);
+}
@@ -0,0 +1,19 @@
+#ifndef _FREEZE
+#define _FREEZE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+#include "game_struct.h"
+#include "perfctr.h"
+
+#define BENCH_DESCENTS 200000   /* Random root to leaf walks timed */
+#define BENCH_CALIBRATE 1001    /* Clock reading pairs timed for overhead */
+
+turn_t *freeze_tree(turn_t *root);
+void free_frozen_tree(turn_t *root);
+void release_frozen_buffer(void);
+void descent_benchmark(turn_t *root, const char *label);
+
+#endif
@@ -1,17 +1,109 @@
 #include "game_struct.h"
+#include "win_kernel.h"
+#include "perfctr.h"
+
+/* Mask-indexed move tables generated at build time by gen_tables */
+#ifndef MOVE_TABLES
+#define MOVE_TABLES "move_tables.h"
+#endif
+#include MOVE_TABLES
+
+/**==================================MEMORY==================================**/
+
+/* Turns and children arrays are carved from slabs in ARENA_GRAIN size
+ * classes, each with a free list, so freeing a subtree only pushes onto the
+ * lists, and every slab is handed back at once on exit. Like the tree, the
+ * arena is only touched under tree_lock or by a single thread. */
+
+static char **slabs = NULL;
+static int num_slabs = 0, max_slabs = 0;
+static char *slab_next = NULL, *slab_end = NULL;
+static void *free_lists[ARENA_CLASSES];
+static long long num_turns_made = 0;
+
+/* Buffer holding a frozen tree (see freeze.c), only ever freed whole */
+static char *frozen_start = NULL, *frozen_end = NULL;
+
+/* Returns size bytes from the arena, or NULL if size is 0 */
+static void *arena_alloc(size_t size) {
+    if (size == 0) return NULL;
+    size_t class = (size + ARENA_GRAIN - 1)/ARENA_GRAIN;
+    assert(class < ARENA_CLASSES);
+    void *ptr = free_lists[class];
+    if (ptr != NULL) {
+        free_lists[class] = *(void**)ptr;
+        return ptr;
+    }
+    if (slab_next + class*ARENA_GRAIN > slab_end) {
+        if (num_slabs == max_slabs) {
+            max_slabs = max_slabs ? 2*max_slabs : 64;
+            slabs = (char**)realloc(slabs, max_slabs*sizeof(char*));
+            assert(slabs);
+        }
+        slab_next = slabs[num_slabs++] = (char*)malloc(ARENA_SLAB);
+        assert(slab_next);
+        slab_end = slab_next + ARENA_SLAB;
+    }
+    ptr = slab_next;
+    slab_next += class*ARENA_GRAIN;
+    return ptr;
+}
+
+/* Returns size bytes at ptr to the arena, unless part of a frozen tree */
+static void arena_free(void *ptr, size_t size) {
+    if (ptr == NULL) return;
+    if ((char*)ptr >= frozen_start && (char*)ptr < frozen_end) return;
+    size_t class = (size + ARENA_GRAIN - 1)/ARENA_GRAIN;
+    *(void**)ptr = free_lists[class];
+    free_lists[class] = ptr;
+}
+
+/* Allocates an array for num_children children */
+turn_t **alloc_children(int num_children) {
+    return (turn_t**)arena_alloc(num_children*sizeof(turn_t*));
+}
+
+/* Frees turn and its children array, but not the children */
+void free_turn(turn_t *turn) {
+    assert(turn);
+    arena_free(turn->children, turn->num_children*sizeof(turn_t*));
+    arena_free(turn, sizeof(turn_t));
+}
+
+/* Registers the buffer of a frozen tree, or none if start is NULL */
+void set_frozen_buffer(void *start, size_t size) {
+    frozen_start = (char*)start;
+    frozen_end = frozen_start + (start ? size : 0);
+}
+
+/* Frees every turn and children array at once, leaving no tree usable;
+    the cheap way to tear down before exit */
+void release_tree_memory(void) {
+    int i;
+    for (i = 0; i < num_slabs; i++) free(slabs[i]);
+    free(slabs);
+    slabs = NULL;
+    num_slabs = max_slabs = 0;
+    slab_next = slab_end = NULL;
+    for (i = 0; i < ARENA_CLASSES; i++) free_lists[i] = NULL;
+}
 
 /**==============================TURN CREATION===============================**/
 
 /* Allocates turn_t and returns pointer */
 turn_t *make_empty_turn(void) {
-    turn_t *turn = (turn_t*)malloc(sizeof(turn_t));
+    turn_t *turn = (turn_t*)arena_alloc(sizeof(turn_t));
     assert(turn);
+    num_turns_made++;
     turn->move.entry = turn->move.row = turn->move.col = EMPTY;
     turn->parent = NULL;
     turn->children = NULL;
     turn->num_children = EMPTY;
     turn->win_state = FALSE;
     turn->bad_state = FALSE;
+    turn->repeat_state = FALSE;
+    turn->dist = 0;
+    turn->key = 0;
     return turn;
 }
 
@@ -39,6 +131,25 @@ int create_board(turn_t *turn, board_t stor) {
     return num_moves;
 }
 
+/* Returns the empty squares of mask in ascending order and their count; uses
+    the generated table when the board has one, else scans into stor */
+const unsigned char *empty_squares(mask_t mask, int *count,
+        unsigned char stor[]) {
+#if HAVE_MOVE_TABLES
+    *count = empty_count[mask];
+    return empty_list[mask];
+#else
+    mask_t empty = ~mask & ((1u << NUM_SQUARES) - 1);
+    int num = 0;
+    while (empty) {
+        stor[num++] = __builtin_ctz(empty);
+        empty &= empty - 1;
+    }
+    *count = num;
+    return stor;
+#endif
+}
+
 /* Determines next entry */
 int next_move(turn_t *parent) {
     assert(parent);
@@ -49,135 +160,319 @@ int next_move(turn_t *parent) {
     }
 }
 
-/* Identifies a winning turn & returns -1 if none, 0 if even and 1 if odd.
-    It is assumed that only one win condition can be present by game nature. */
-int is_game_over(turn_t *turn) {
-    board_t curr_board;
-    int curr_num_moves = create_board(turn, curr_board);
-    if (curr_num_moves < 3) {
-        return FALSE;
-    }
+/* Returns the key of the position after entry is written on square */
+pos_key_t child_key(pos_key_t parent_key, int square, int entry) {
+    pos_key_t window = ((parent_key << SQ_BITS) | (square + 1)) & WINDOW_MASK;
+    return window | ((pos_key_t)(entry % BASE) << WINDOW_BITS);
+}
 
-    int result, i, val_stor[ROWS];
-    int move_row = turn->move.row, move_col = turn->move.col;
+/* Returns the occupancy mask of the position packed in key */
+mask_t key_occupied(pos_key_t key) {
+    mask_t mask = 0;
+    int slot, sq;
+    for (slot = 0; slot < MAX_MOVES; slot++) {
+        if ((sq = KEY_SLOT(key, slot))) mask |= 1u << (sq - 1);
+    }
+    return mask;
+}
 
-    /* Check row of the move made */
-    for (i = 0; i < COLS; i++) {
-        val_stor[i] = curr_board[move_row][i];
+/* Returns the mask of tiles sharing the newest entry's residue in key, i.e.
+    every BASE-th slot, as entries in the window are consecutive */
+mask_t key_mover(pos_key_t key) {
+    mask_t mask = 0;
+    int slot, sq;
+    for (slot = 0; slot < MAX_MOVES; slot += BASE) {
+        if ((sq = KEY_SLOT(key, slot))) mask |= 1u << (sq - 1);
     }
-    result = three_in_row(val_stor);
-    if (result) return result;
+    return mask;
+}
 
-    /* Check col of the move made */
-    for (i = 0; i < ROWS; i++) {
-        val_stor[i] = curr_board[i][move_col];
+/* Checks if the tiles in side cover a whole line */
+int mask_wins(mask_t side) {
+    int i;
+    for (i = 0; i < NUM_LINES; i++) {
+        if ((side & line_masks[i]) == line_masks[i]) return TRUE;
     }
-    result = three_in_row(val_stor);
-    if (result) return result;
+    return FALSE;
+}
+
+/* Returns the generated line masks and their number */
+const mask_t *win_lines(int *num_lines) {
+    *num_lines = NUM_LINES;
+    return line_masks;
+}
 
-    /* Check \ diag if move in it */
-    if (move_row == move_col) {
-        for (i = 0; i < COLS; i++) {
-            val_stor[i] = curr_board[i][i];
+/* Checks if turn's position already occurred on the path back to the root.
+    Squares in a window are distinct, so a repeat is at least MAX_MOVES plies
+    back, and only positions with the same residue to move can match */
+int is_repetition(turn_t *turn) {
+    assert(turn);
+    turn_t *curr = turn;
+    int dist = 0;
+    while (curr->parent != NULL) {
+        curr = curr->parent;
+        dist++;
+        if (dist >= MAX_MOVES && dist % BASE == 0 && curr->key == turn->key) {
+            return TRUE;
         }
-        result = three_in_row(val_stor);
-        if (result) return result;
     }
+    return FALSE;
+}
 
-    /* Check / diag if move in it */
-    if (move_row == ROWS - move_col - 1) {
-        for (i = 0; i < COLS; i++) {
-            val_stor[i] = curr_board[i][ROWS - i - 1];
-        }
-        result = three_in_row(val_stor);
-        if (result) return result;
+/**===============================MOVE STREAMING=============================**/
+
+/* Prepares iter to stream the legal moves of parent without allocating */
+void move_iter_init(move_iter_t *iter, turn_t *parent) {
+    assert(parent);
+    iter->parent = parent;
+    iter->key = parent->key;
+    iter->squares = empty_squares(key_occupied(parent->key), &iter->num_moves,
+            iter->square_stor);
+    iter->next = 0;
+    iter->entry = next_move(parent);
+}
+
+/* Writes the next legal move to move; returns FALSE once exhausted */
+int move_iter_next(move_iter_t *iter, move_t *move) {
+    if (iter->next == iter->num_moves) {
+        return FALSE;
     }
+    int square = iter->squares[iter->next++];
+    *move = (move_t){
+        .row = SQUARE_ROW(square),
+        .col = SQUARE_COL(square),
+        .entry = iter->entry
+    };
+    return TRUE;
+}
 
-    return FALSE;
+/* Checks if move from iter's parent wins, from its packed position alone */
+int move_iter_wins(move_iter_t *iter, move_t move) {
+    return mask_wins(key_mover(child_key(iter->key,
+            SQUARE(move.row, move.col), move.entry)));
 }
 
-/* Checks if passed int array gives win condition and returns the state */
-int three_in_row(int val_stor[]) {
+/* Flags which of iter's remaining moves win, as one batch over the siblings */
+void move_iter_batch_wins(move_iter_t *iter, unsigned char wins[]) {
+    pos_key_t keys[NUM_SQUARES];
     int i;
-    for (i = 1; i < ROWS; i++) {
-        if (val_stor[i-1] == EMPTY || val_stor[i] == EMPTY) {
-            return FALSE;
+    for (i = iter->next; i < iter->num_moves; i++) {
+        keys[i - iter->next] = child_key(iter->key, iter->squares[i],
+                iter->entry);
+    }
+    batch_wins(keys, iter->num_moves - iter->next, wins);
+}
+
+/* Materialises the child of parent playing move, with known win_state */
+turn_t *make_child(turn_t *parent, move_t move, int win_state) {
+    assert(parent);
+    turn_t *new_turn = make_empty_turn();
+    new_turn->move = move;
+    new_turn->parent = parent;
+    new_turn->key = child_key(parent->key, SQUARE(move.row, move.col),
+            move.entry);
+    new_turn->win_state = win_state;
+    /* Repeated lines are cut here and count as draws */
+    if (!win_state) {
+        new_turn->repeat_state = is_repetition(new_turn);
+    }
+    return new_turn;
+}
+
+/* Returns parent's child playing row x col, materialising it (and any other
+    siblings skipped by lazy expansion) if needed; NULL if illegal */
+turn_t *find_child(turn_t *parent, int row, int col) {
+    assert(parent);
+    int i;
+    for (i = 0; i < parent->num_children; i++) {
+        turn_t *tmp = parent->children[i];
+        if (tmp->move.row == row && tmp->move.col == col) return tmp;
+    }
+    if (parent->num_children) {
+        complete_children(parent);
+        for (i = 0; i < parent->num_children; i++) {
+            turn_t *tmp = parent->children[i];
+            if (tmp->move.row == row && tmp->move.col == col) return tmp;
         }
-        if (val_stor[i-1] % BASE != val_stor[i] % BASE) {
-            return FALSE;
+    }
+    return NULL;
+}
+
+/* Materialises every child skipped by lazy expansion, in move order */
+void complete_children(turn_t *parent) {
+    assert(parent);
+    move_iter_t iter;
+    move_t move;
+    move_iter_init(&iter, parent);
+    if (parent->num_children == iter.num_moves) return;
+
+    turn_t **child_arr = alloc_children(iter.num_moves);
+    unsigned char wins[NUM_SQUARES];
+    move_iter_batch_wins(&iter, wins);
+    int i = 0, j = 0;
+    while (move_iter_next(&iter, &move)) {
+        if (j < parent->num_children &&
+                parent->children[j]->move.row == move.row &&
+                parent->children[j]->move.col == move.col) {
+            child_arr[i] = parent->children[j++];
+        } else {
+            child_arr[i] = make_child(parent, move, wins[i]);
         }
+        i++;
     }
-    return TRUE;
+    arena_free(parent->children, parent->num_children*sizeof(turn_t*));
+    parent->children = child_arr;
+    parent->num_children = iter.num_moves;
 }
 
 /**==============================GAME CREATION===============================**/
 
+/* Selects create_children_lazy over create_children during generation */
+static int lazy_expansion = FALSE;
+
+/* Enables or disables lazy expansion for later generation */
+void set_lazy_expansion(int lazy) {
+    lazy_expansion = lazy;
+}
+
+/* Frees the subtrees of proven turns during generation, see prune_decided */
+static int pruning = FALSE;
+
+/* Enables or disables pruning for later generation */
+void set_pruning(int prune) {
+    pruning = prune;
+}
+
+/* Checks if generation prunes proven turns */
+int pruning_enabled(void) {
+    return pruning;
+}
+
 /* Finds all children turns for a given parent and links parent to children */
 void create_children(turn_t *parent) {
     assert(parent);
-    /* Create board, get number of children, get next entry to be put in */
-    board_t curr_board;
-    int curr_num_moves = create_board(parent, curr_board);
-    int num_possible_moves = NUM_SQUARES - curr_num_moves;
-
-    /* Create nodes for all potential children */
-    turn_t **child_arr = (turn_t**)malloc(num_possible_moves*sizeof(turn_t*));
-    assert(child_arr);
-    turn_t *new_turn;
-    int entry = next_move(parent);
-    int row, col, i = 0;
-    for (row = 0; row < ROWS; row++) {
-        for (col = 0; col < COLS; col++) {
-            if (curr_board[row][col] == EMPTY) {
-                /* A new move! Create the child and add ptr to children */
-                new_turn = make_empty_turn();
-                assert(new_turn);
-                /* TODO: Unsure if cast to move_t is necessary */
-                new_turn->move = (move_t){
-                    .row = row,
-                    .col = col,
-                    .entry = entry
-                };
-                new_turn->parent = parent;
-                new_turn->win_state = is_game_over(new_turn);
-                *(child_arr+i) = new_turn;
-                i++;
-            }
-        }
+    move_iter_t iter;
+    move_t move;
+    move_iter_init(&iter, parent);
+
+    /* Create nodes for all potential children, win checked as one batch */
+    turn_t **child_arr = alloc_children(iter.num_moves);
+    unsigned char wins[NUM_SQUARES];
+    move_iter_batch_wins(&iter, wins);
+    int i = 0;
+    while (move_iter_next(&iter, &move)) {
+        child_arr[i] = make_child(parent, move, wins[i]);
+        i++;
     }
 
     parent->children = child_arr;
-    parent->num_children = num_possible_moves;
+    parent->num_children = iter.num_moves;
     return;
 }
 
+/* As create_children, but streams the moves first and stops at the first win,
+    materialising only that child since it decides parent on its own */
+void create_children_lazy(turn_t *parent) {
+    assert(parent);
+    move_iter_t iter;
+    move_t move;
+    move_iter_init(&iter, parent);
+    while (move_iter_next(&iter, &move)) {
+        if (move_iter_wins(&iter, move)) {
+            parent->children = alloc_children(1);
+            parent->children[0] = make_child(parent, move, TRUE);
+            parent->num_children = 1;
+            return;
+        }
+    }
+
+    /* No win; every child is needed, and none wins */
+    turn_t **child_arr = alloc_children(iter.num_moves);
+    int i = 0;
+    iter.next = 0;
+    while (move_iter_next(&iter, &move)) {
+        child_arr[i++] = make_child(parent, move, FALSE);
+    }
+    parent->children = child_arr;
+    parent->num_children = iter.num_moves;
+}
+
+/* Renders turn BAD, as the next player to move wins dist plies later, keeping
+    the fastest such win */
+void mark_bad(turn_t *turn, int dist) {
+    assert(turn);
+    if (!turn->bad_state || dist < turn->dist) {
+        turn->dist = dist;
+    }
+    turn->bad_state = TRUE;
+}
+
 /* If a winner, renders parent's parent BAD */
 void update_bad_states(turn_t *parent) {
     assert(parent);
     if (parent->num_children == EMPTY && parent->win_state) {
         /* An winning scenario at the frontier of generations */
-        parent->parent->bad_state = TRUE;
+        mark_bad(parent->parent, parent->dist + 1);
         return;
     }
 }
 
-/* Check if all parent's children are BAD, and make it a winner if so */
+#if BASE > 2
+/* Checks if every line of moves by the other players, plies deep below
+    parent, reaches a BAD turn, i.e. one handing the move back to parent's
+    mover with a forced win; max_dist gets the slowest win from parent's
+    children. Undecided turns on the way must be expanded, and any decided
+    one means another player wins first */
+static int replies_all_bad(turn_t *parent, int plies, int *max_dist) {
+    int i, dist;
+    for (i = 0; i < parent->num_children; i++) {
+        turn_t *child = parent->children[i];
+        if (plies == 1) {
+            if (!child->bad_state) return FALSE;
+            dist = child->dist;
+        } else {
+            dist = 0;
+            if (child->win_state || child->bad_state || !child->num_children ||
+                    !replies_all_bad(child, plies - 1, &dist)) {
+                return FALSE;
+            }
+            dist++;
+        }
+        if (dist > *max_dist) *max_dist = dist;
+    }
+    return TRUE;
+}
+#endif
+
+/* Check if all parent's children are BAD, and make it a winner if so. With
+    more than two players, BAD must be reached after every line of the
+    other BASE - 1 players' moves */
 void update_win_states(turn_t *parent) {
     assert(parent);
     if (parent->num_children && parent->win_state == FALSE &&
             parent->bad_state == FALSE) {
+        /* Opponent resists as long as possible, so dist is the slowest */
+        int children_all_bad_state = TRUE, max_dist = 0;
+#if BASE > 2
+        children_all_bad_state = replies_all_bad(parent, BASE - 1, &max_dist);
+#else
         /* Need to check if all children are bad or not. */
-        int i, children_all_bad_state = TRUE;
+        int i;
         for (i = 0; i < parent->num_children; i++) {
             if (parent->children[i]->bad_state != TRUE) {
                 children_all_bad_state = FALSE;
                 break;
             }
+            if (parent->children[i]->dist > max_dist) {
+                max_dist = parent->children[i]->dist;
+            }
         }
+#endif
         if (children_all_bad_state) {
             parent->win_state = TRUE;
+            parent->dist = max_dist + 1;
             if (parent->parent != NULL) {
-                parent->parent->bad_state = TRUE;
+                mark_bad(parent->parent, parent->dist + 1);
             }
         }
     }
@@ -189,8 +484,13 @@ void traverse_and_create(turn_t *parent) {
     if (parent->win_state || parent->bad_state) {
         if (parent->move.entry != EMPTY) return;
     }
+    if (parent->repeat_state) return;
     if (parent->num_children == EMPTY) {
-        create_children(parent);
+        if (lazy_expansion) {
+            create_children_lazy(parent);
+        } else {
+            create_children(parent);
+        }
         return;
     } else {
         int i;
@@ -200,6 +500,36 @@ void traverse_and_create(turn_t *parent) {
     }
 }
 
+/* If pruning, frees what can no longer change turn's proven outcome: a BAD
+    turn keeps only its fastest winning child, the refutation, while a WIN
+    turn needs all its children, which being BAD prune themselves. The
+    empty board is kept whole, as generation goes on expanding it */
+void prune_decided(turn_t *turn) {
+    assert(turn);
+    if (!pruning || !turn->bad_state || turn->num_children <= 1) return;
+    if (turn->move.entry == EMPTY) return;
+    int i;
+    turn_t *principal = NULL;
+    for (i = 0; i < turn->num_children; i++) {
+        turn_t *tmp = turn->children[i];
+        if (tmp->win_state && (principal == NULL ||
+                tmp->dist < principal->dist)) {
+            principal = tmp;
+        }
+    }
+    if (principal == NULL) return;
+    for (i = 0; i < turn->num_children; i++) {
+        if (turn->children[i] != principal) {
+            free_tree(turn->children[i], TRUE);
+        }
+    }
+    /* Arrays are freed by their length, so this one is replaced */
+    arena_free(turn->children, turn->num_children*sizeof(turn_t*));
+    turn->children = alloc_children(1);
+    turn->children[0] = principal;
+    turn->num_children = 1;
+}
+
 /* Recursion to find tree endpoints and updates win/bad states from bottom up */
 void traverse_and_update(turn_t *parent) {
     assert(parent);
@@ -211,21 +541,31 @@ void traverse_and_update(turn_t *parent) {
     }
     update_bad_states(parent);
     update_win_states(parent);
+    prune_decided(parent);
 }
 
 /* Generate children depth extra layers starting at root */
 void generate_children(turn_t *root, int depth) {
     assert(root);
+    /* Play has reached root, so expand it even if it was cut as a repeat */
+    root->repeat_state = FALSE;
     /* Generate the children at endpoints of tree, depth times */
     int i;
     for (i = 0; i < depth; i++) {
+        /* Both phases are counted per turn the layer adds */
+        long long made = num_turns_made;
+        perf_start();
         traverse_and_create(root);
+        perf_stop(PHASE_CREATE, num_turns_made - made);
+        perf_start();
         traverse_and_update(root);
+        perf_stop(PHASE_UPDATE, num_turns_made - made);
     }
 }
 
-/* Determines best option for opponent, and the depth from parent, as struct
- * Note: if many children with winning tags, does not compare them */
+/* Determines best option for opponent, and the depth from parent, as struct.
+ * Proven children are ranked by dist alone: the fastest win, else undecided
+ * children by search, else the bad child that loses slowest */
 best_child_t best_child(turn_t *parent) {
     assert(parent);
     int i;
@@ -234,16 +574,14 @@ best_child_t best_child(turn_t *parent) {
     best_child_t curr_best = tmp_best;
     for (i = 0; i < parent->num_children; i++) {
         tmp = parent->children[i];
-        if (tmp->win_state) {   /* Child will lead to a win; this is best */
-            if (tmp->num_children) {
-                curr_best = best_child(tmp);
-                curr_best.best = tmp;
-                break;
-            } else {
-                curr_best = (best_child_t) {.best = tmp, .depth = 0};
-                break;
-            }
-        } else if (tmp->bad_state) {    /* Bad; avoid at all cost */
+        if (tmp->win_state && (curr_best.best == NULL ||
+                !curr_best.best->win_state || tmp->dist < curr_best.depth)) {
+            /* Child will lead to a win; fastest one is best */
+            curr_best = (best_child_t) {.best = tmp, .depth = tmp->dist};
+        } else if (tmp->win_state || tmp->bad_state) {
+            /* Slower win, or bad; avoid at all cost */
+            continue;
+        } else if (curr_best.best != NULL && curr_best.best->win_state) {
             continue;
         } else if (curr_best.best == NULL) {    /* First non_bad, non_win */
             /* Calculates best option for player using PARENT, i.e. worst
@@ -258,16 +596,11 @@ best_child_t best_child(turn_t *parent) {
             if (tmp_best.depth > curr_best.depth) curr_best = tmp_best;
         }
     }
-    if (curr_best.best == NULL) {/* All bad children; pick the least worst */
+    if (curr_best.best == NULL) {/* All bad children; resist the longest */
         for (i = 0; i < parent->num_children; i++) {
             tmp = parent->children[i];
-            if (curr_best.best == NULL) {   /* First bad */
-                curr_best = best_child(tmp);
-                curr_best.best = tmp;
-            } else {    /* Compare curr_best and tmp */
-                best_child_t tmp_best = best_child(tmp);
-                tmp_best.best = tmp;
-                if (tmp_best.depth > curr_best.depth) curr_best = tmp_best;
+            if (curr_best.best == NULL || tmp->dist > curr_best.depth) {
+                curr_best = (best_child_t) {.best = tmp, .depth = tmp->dist};
             }
         }
     }
@@ -275,7 +608,8 @@ best_child_t best_child(turn_t *parent) {
     return curr_best;
 }
 
-/* Free turn_t if free_root and all below it recursively */
+/* Free turn_t if free_root and all below it recursively; each turn only
+    goes back on an arena free list, and recursion is as deep as the tree */
 void free_tree(turn_t *root, int free_root) {
     assert(root);
     int i;
@@ -283,6 +617,10 @@ void free_tree(turn_t *root, int free_root) {
         free_tree(root->children[i], TRUE);
     }
     if (free_root) {
-        free(root);
+        free_turn(root);
+    } else {
+        arena_free(root->children, root->num_children*sizeof(turn_t*));
+        root->children = NULL;
+        root->num_children = EMPTY;
     }
 }
@@ -5,15 +5,74 @@
 #include <stdlib.h>
 #include <assert.h>
 
-#define ROWS 3
-#define COLS 3
-#define NUM_SQUARES 9
-#define MAX_MOVES 6
+/* Rule configuration: an NxN board, k-in-a-row wins, NUM_PLAYERS players each
+ * writing the entries of one residue mod NUM_PLAYERS, and tiles vanish after a
+ * window of MAX_MOVES moves, by default LINE_LEN per player. Override at
+ * compile time (see makefile variants), e.g. -DBOARD_SIZE=4 -DLINE_LEN=4
+ * -DMAX_MOVES=8, so every hot loop below is specialised with constant bounds. */
+#ifndef BOARD_SIZE
+#define BOARD_SIZE 3
+#endif
+#ifndef LINE_LEN
+#define LINE_LEN 3
+#endif
+#ifndef NUM_PLAYERS
+#define NUM_PLAYERS 2
+#endif
+#ifndef MAX_MOVES
+#define MAX_MOVES (NUM_PLAYERS*LINE_LEN)
+#endif
+
+#define ROWS BOARD_SIZE
+#define COLS BOARD_SIZE
+#define NUM_SQUARES (ROWS*COLS)
+#define NUM_DIRS 4
+#define MASK_TABLE_MAX_SQUARES 12   /* Largest board given move_tables.h */
+#define SQUARE(row, col) ((row)*COLS + (col))
+#define SQUARE_ROW(sq) ((sq) / COLS)
+#define SQUARE_COL(sq) ((sq) % COLS)
+#define ON_BOARD(row, col) ((row) >= 0 && (row) < ROWS && (col) >= 0 && \
+        (col) < COLS)
+
+/* Position keys pack the move window, newest square in the low SQ_BITS, each
+ * stored as square + 1 so 0 marks an unused slot; the residue of the newest
+ * entry sits above the window. Equal keys are exactly equal positions. */
+#define SQ_BITS (NUM_SQUARES < 16 ? 4 : 5)
+#define RESIDUE_BITS (NUM_PLAYERS <= 2 ? 1 : (NUM_PLAYERS <= 4 ? 2 : 3))
+#define WINDOW_BITS (SQ_BITS*MAX_MOVES)
+#define WINDOW_MASK ((1ULL << WINDOW_BITS) - 1)
+#define KEY_SLOT(key, slot) ((int)(((key) >> ((slot)*SQ_BITS)) & \
+        ((1 << SQ_BITS) - 1)))
+
+#if NUM_SQUARES > 30
+#error "Boards over 30 squares overflow SQ_BITS and mask_t"
+#endif
+#if WINDOW_BITS + RESIDUE_BITS > 64
+#error "Move window does not fit in a position key"
+#endif
+#if NUM_PLAYERS < 2 || NUM_PLAYERS > 8
+#error "NUM_PLAYERS must be between 2 and 8"
+#endif
+#if LINE_LEN < 2 || LINE_LEN > BOARD_SIZE
+#error "LINE_LEN must be between 2 and BOARD_SIZE"
+#endif
+#if MAX_MOVES >= NUM_SQUARES
+#error "MAX_MOVES must leave at least one empty square"
+#endif
+
 #define FALSE 0
 #define TRUE 1
 #define EMPTY 0
-#define BASE 2
+#define BASE NUM_PLAYERS
 
+#define ARENA_SLAB (1 << 20)    /* Bytes the turn arena grows by */
+#define ARENA_GRAIN 8           /* Arena size classes are multiples of this */
+#define ARENA_CLASSES (NUM_SQUARES + 9)
+/* Bytes the arena hands out for a request of size */
+#define ARENA_BYTES(size) (((size) + ARENA_GRAIN - 1)/ARENA_GRAIN*ARENA_GRAIN)
+
+typedef unsigned long long pos_key_t;
+typedef unsigned int mask_t;    /* Bit SQUARE(row, col) set if occupied */
 typedef int row_t[COLS];
 typedef row_t board_t[ROWS];    /* i.e. board_t[ROW#][COL#] */
 
@@ -29,26 +88,67 @@ struct turn_s {
     int num_children;
     int win_state;      /* Flag if a turn wins */
     int bad_state;      /* Flag TRUE if choosing guarantees opponent wins */
+    int repeat_state;   /* Flag TRUE if position repeats one on its path */
+    int dist;           /* If win/bad, exact plies until the winning move */
+    pos_key_t key;      /* Packed position, see SQ_BITS */
     turn_t *parent;
     turn_t **children;
 };
 
-/* Data struct for child optimisation */
+/* Streams the legal moves of a turn from its packed position */
+typedef struct {
+    turn_t *parent;
+    pos_key_t key;
+    const unsigned char *squares;
+    unsigned char square_stor[NUM_SQUARES];
+    int num_moves, next, entry;
+} move_iter_t;
+
+/* Data struct for child optimisation; depth is exact plies to the end of the
+ * game from parent when best is proven (win or bad) */
 typedef struct {
     turn_t *best;
     int depth;
 } best_child_t;
 
+/* Turn memory */
+turn_t **alloc_children(int num_children);
+void free_turn(turn_t *turn);
+void set_frozen_buffer(void *start, size_t size);
+void release_tree_memory(void);
+
 /* Turn creation */
 turn_t *make_empty_turn(void);
 int create_board(turn_t *turn, board_t stor);
+const unsigned char *empty_squares(mask_t mask, int *count,
+        unsigned char stor[]);
 int next_move(turn_t *parent);
-int is_game_over(turn_t *turn);
-int three_in_row(int val_stor[]);
+pos_key_t child_key(pos_key_t parent_key, int square, int entry);
+mask_t key_occupied(pos_key_t key);
+mask_t key_mover(pos_key_t key);
+int mask_wins(mask_t side);
+const mask_t *win_lines(int *num_lines);
+
+int is_repetition(turn_t *turn);
+
+/* Move streaming */
+void move_iter_init(move_iter_t *iter, turn_t *parent);
+int move_iter_next(move_iter_t *iter, move_t *move);
+int move_iter_wins(move_iter_t *iter, move_t move);
+void move_iter_batch_wins(move_iter_t *iter, unsigned char wins[]);
+turn_t *make_child(turn_t *parent, move_t move, int win_state);
+turn_t *find_child(turn_t *parent, int row, int col);
+void complete_children(turn_t *parent);
 
 /* Game creation */
+void set_lazy_expansion(int lazy);
+void set_pruning(int prune);
+int pruning_enabled(void);
+void prune_decided(turn_t *turn);
 void create_children(turn_t *parent);
+void create_children_lazy(turn_t *parent);
 void update_win_states(turn_t *parent);
+void mark_bad(turn_t *turn, int dist);
 void update_bad_states(turn_t *parent);
 void traverse_and_create(turn_t *parent);
 void traverse_and_update(turn_t *parent);
@@ -0,0 +1,284 @@
+#include "gamelog.h"
+
+/* Game logs: every game the simulator plays is appended to a binary log, a
+ * byte per move through a stdio buffer, never synced. Replaying a log solves
+ * each position it reached with search.c, on all cores sharing one table,
+ * and reports where a forced win was given away or drawn out. */
+
+/* The open log, if games are being recorded */
+static FILE *game_log = NULL;
+
+/**=================================RECORDING================================**/
+
+/* Checks that the header of a log holds these rules */
+static int header_matches(gamelog_header_t *header) {
+    return header->magic == GAMELOG_MAGIC &&
+            header->version == GAMELOG_VERSION &&
+            header->board_size == BOARD_SIZE && header->line_len == LINE_LEN &&
+            header->max_moves == MAX_MOVES && header->base == BASE;
+}
+
+/* Opens the log at path for appending games, creating it if need be;
+    returns FALSE if it cannot, or holds games of other rules */
+int open_game_log(const char *path) {
+    assert(game_log == NULL);
+    gamelog_header_t header;
+    FILE *fp = fopen(path, "rb");
+    if (fp != NULL) {
+        size_t read = fread(&header, sizeof(header), 1, fp);
+        fclose(fp);
+        if (read == 1 && !header_matches(&header)) return FALSE;
+    }
+    game_log = fopen(path, "ab");
+    if (game_log == NULL) return FALSE;
+    setvbuf(game_log, NULL, _IOFBF, GAMELOG_BUFFER);
+    fseek(game_log, 0, SEEK_END);
+    if (ftell(game_log) == 0) {
+        header = (gamelog_header_t) {
+            .magic = GAMELOG_MAGIC, .version = GAMELOG_VERSION,
+            .board_size = BOARD_SIZE, .line_len = LINE_LEN,
+            .max_moves = MAX_MOVES, .base = BASE
+        };
+        fwrite(&header, sizeof(header), 1, game_log);
+    }
+    return TRUE;
+}
+
+/* Starts a game in the log */
+void log_new_game(void) {
+    if (game_log != NULL) putc(LOG_NEW_GAME, game_log);
+}
+
+/* Logs the move made to reach turn, flagged if the engine chose it */
+void log_move(turn_t *turn, int computer) {
+    if (game_log == NULL) return;
+    assert(turn);
+    int square = SQUARE(turn->move.row, turn->move.col);
+    putc(square | (computer ? LOG_COMPUTER : 0), game_log);
+}
+
+/* Logs that the last move was taken back */
+void log_undo(void) {
+    if (game_log != NULL) putc(LOG_UNDO, game_log);
+}
+
+/* Flushes and closes the log */
+void close_game_log(void) {
+    if (game_log == NULL) return;
+    fclose(game_log);
+    game_log = NULL;
+}
+
+/**==================================REPLAY==================================**/
+
+/* Rebuilds the keys of a game from its bytes into path, and who moved into
+    movers; returns its plies, or -1 if it breaks the rules */
+static int replay_keys(const unsigned char *bytes, long long len,
+        pos_key_t path[], unsigned char movers[]) {
+    int ply = 0;
+    long long i;
+    path[0] = 0;
+    for (i = 0; i < len; i++) {
+        if (bytes[i] == LOG_UNDO) {
+            if (ply > 0) ply--;
+            continue;
+        }
+        int square = bytes[i] & LOG_SQUARE;
+        if (ply == REPLAY_MAX_PLIES - 1) break;
+        if (square >= NUM_SQUARES ||
+                (key_occupied(path[ply]) & (1u << square)) ||
+                (ply > 0 && mask_wins(key_mover(path[ply])))) {
+            return -1;
+        }
+        movers[ply] = (bytes[i] & LOG_COMPUTER) ? COMPUTER : HUMAN;
+        path[ply+1] = child_key(path[ply], square, ply + 1);
+        ply++;
+    }
+    return ply;
+}
+
+/* Solves the turn at ply of a game's keys on a scratch copy of its path */
+static int replay_solve(replay_t *replay, pos_key_t keys[], pos_key_t path[],
+        int ply, int horizon, int *dist, long long *nodes) {
+    memcpy(path, keys, (ply + 1)*sizeof(pos_key_t));
+    return solve(replay->tt, path, ply, horizon, dist, nodes);
+}
+
+/* Adds the mistakes of one game to stats: every move made by a player who
+    could force a win is checked to still force it, and as fast */
+static void replay_game(replay_t *replay, long long game, pos_key_t keys[],
+        pos_key_t path[], unsigned char movers[], replay_stats_t *stats) {
+    const unsigned char *bytes = replay->data + replay->starts[game] + 1;
+    long long len = replay->starts[game+1] - replay->starts[game] - 1;
+    int plies = replay_keys(bytes, len, keys, movers), ply, dist, child_dist;
+    if (plies < 0) {
+        stats->corrupt++;
+        return;
+    }
+    stats->games++;
+    stats->moves += plies;
+    for (ply = 0; ply < plies; ply++) {
+        /* BAD for the last mover is a forced win for the one moving now */
+        if (replay_solve(replay, keys, path, ply, replay->horizon, &dist,
+                &stats->nodes) != SEARCH_BAD) {
+            continue;
+        }
+        int who = movers[ply];
+        stats->won[who]++;
+        int state = replay_solve(replay, keys, path, ply + 1,
+                replay->horizon - 1, &child_dist, &stats->nodes);
+        if (state != SEARCH_WIN) {
+            stats->blunders[who]++;
+            stats->blunders_at[ply < REPORT_PLIES ? ply : REPORT_PLIES]++;
+        } else if (child_dist > dist - 1) {
+            stats->slow[who]++;
+            stats->plies_lost[who] += child_dist - (dist - 1);
+        }
+    }
+}
+
+/* Worker body: replays batches of games until none are left */
+static void *replay_worker(void *arg) {
+    replay_t *replay = ((replay_worker_t*)arg)->replay;
+    replay_stats_t *stats = &((replay_worker_t*)arg)->stats;
+    int path_len = REPLAY_MAX_PLIES + replay->horizon + 1;
+    pos_key_t *keys = (pos_key_t*)malloc(path_len*sizeof(pos_key_t));
+    pos_key_t *path = (pos_key_t*)malloc(path_len*sizeof(pos_key_t));
+    unsigned char *movers = (unsigned char*)malloc(REPLAY_MAX_PLIES);
+    assert(keys && path && movers);
+    long long first, game;
+    while ((first = atomic_fetch_add(&replay->next_game, REPLAY_TASK)) <
+            replay->num_games) {
+        for (game = first; game < first + REPLAY_TASK &&
+                game < replay->num_games; game++) {
+            replay_game(replay, game, keys, path, movers, stats);
+        }
+    }
+    tt_flush_stats(replay->tt);
+    free(keys);
+    free(path);
+    free(movers);
+    return NULL;
+}
+
+/* Adds the counts of from into to */
+static void merge_stats(replay_stats_t *to, replay_stats_t *from) {
+    long long *dst = (long long*)to, *src = (long long*)from;
+    size_t i;
+    for (i = 0; i < sizeof(replay_stats_t)/sizeof(long long); i++) {
+        dst[i] += src[i];
+    }
+}
+
+/* Prints the mistakes found, for humans and for the computer */
+static void print_replay(replay_stats_t *stats, int horizon, double seconds) {
+    static const char *names[2] = {"Human", "Computer"};
+    int who, ply;
+    printf("Replayed %lld games, %lld moves in %.2fs (%lld corrupt skipped), "
+            "solving %d plies deep over %lld turns\n", stats->games,
+            stats->moves, seconds, stats->corrupt, horizon, stats->nodes);
+    printf("%9s %14s %12s %12s %12s\n", "Player", "From a win", "Blunders",
+            "Slow wins", "Plies lost");
+    for (who = HUMAN; who <= COMPUTER; who++) {
+        printf("%9s %14lld %12lld %12lld %12lld\n", names[who],
+                stats->won[who], stats->blunders[who], stats->slow[who],
+                stats->plies_lost[who]);
+    }
+    printf("Blunders by ply:");
+    for (ply = 0; ply <= REPORT_PLIES; ply++) {
+        if (stats->blunders_at[ply] == 0) continue;
+        printf(" %d%s:%lld", ply, (ply == REPORT_PLIES) ? "+" : "",
+                stats->blunders_at[ply]);
+    }
+    printf("\n");
+}
+
+/* Replays every game logged at path on all cores, solving each position
+    horizon plies deep with a shared table of megabytes, and prints where
+    forced wins were thrown away or slowed down; returns FALSE if the log
+    cannot be read */
+int analyse_game_log(const char *path, int horizon, int megabytes) {
+    if (BASE != 2) {
+        /* Positions are judged by solve, a two-player search */
+        printf("Replay analysis needs a two-player game\n");
+        return FALSE;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return FALSE;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(gamelog_header_t)) {
+        close(fd);
+        return FALSE;
+    }
+    const unsigned char *data = (const unsigned char*)mmap(NULL, st.st_size,
+            PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return FALSE;
+    gamelog_header_t header;
+    memcpy(&header, data, sizeof(header));
+    if (!header_matches(&header)) {
+        fprintf(stderr, "%s is not a game log for these rules\n", path);
+        munmap((void*)data, st.st_size);
+        return FALSE;
+    }
+    madvise((void*)data, st.st_size, MADV_SEQUENTIAL);
+
+    /* Index the games, then share them out */
+    long long i, num_games = 0, cap = 1024;
+    long long *starts = (long long*)malloc(cap*sizeof(long long));
+    assert(starts);
+    for (i = sizeof(header); i < st.st_size; i++) {
+        if (data[i] != LOG_NEW_GAME) continue;
+        if (num_games + 1 == cap) {
+            cap *= 2;
+            starts = (long long*)realloc(starts, cap*sizeof(long long));
+            assert(starts);
+        }
+        starts[num_games++] = i;
+    }
+    starts[num_games] = st.st_size;
+
+    replay_t replay = {.tt = make_tt(megabytes), .horizon = horizon,
+            .data = data, .starts = starts, .num_games = num_games};
+    atomic_init(&replay.next_game, 0);
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN), t;
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+    pthread_t threads[MAX_THREADS];
+    replay_worker_t *workers = (replay_worker_t*)calloc(num_threads,
+            sizeof(replay_worker_t));
+    replay_stats_t stats = {0};
+    assert(workers);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (t = 0; t < num_threads; t++) {
+        workers[t].replay = &replay;
+        if (pthread_create(&threads[t], NULL, replay_worker,
+                &workers[t]) != 0) {
+            /* The threads started share out every game regardless */
+            fprintf(stderr, "Started only %d of %d threads\n", t,
+                    num_threads);
+            num_threads = t;
+            break;
+        }
+    }
+    if (num_threads == 0) {
+        replay_worker(&workers[0]);
+        merge_stats(&stats, &workers[0].stats);
+    }
+    for (t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+        merge_stats(&stats, &workers[t].stats);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    print_replay(&stats, horizon, (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec)*1e-9);
+    tt_print_stats(replay.tt);
+
+    free_tt(replay.tt);
+    free(workers);
+    free(starts);
+    munmap((void*)data, st.st_size);
+    return TRUE;
+}
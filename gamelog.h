@@ -0,0 +1,70 @@
+#ifndef _GAMELOG
+#define _GAMELOG
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "game_struct.h"
+#include "search.h"
+
+#define GAMELOG_MAGIC 0x4c47454fu   /* "OEGL" */
+#define GAMELOG_VERSION 1
+#define GAMELOG_BUFFER (1 << 16)    /* Bytes buffered before each write */
+#define LOG_NEW_GAME 0xff           /* Starts every game */
+#define LOG_UNDO 0xfe               /* Takes back the last move */
+#define LOG_COMPUTER 0x80           /* Set on moves the engine chose */
+#define LOG_SQUARE 0x3f             /* Square of a move byte */
+#define REPLAY_MAX_PLIES 4096       /* Longer games are cut here */
+#define REPLAY_TASK 256             /* Games a thread takes at once */
+#define REPORT_PLIES 24             /* Plies reported one by one */
+#define HUMAN 0
+#define COMPUTER 1
+
+/* Log file header; games follow, each LOG_NEW_GAME then a byte per move */
+typedef struct {
+    unsigned int magic, version;
+    int board_size, line_len, max_moves, base;
+} gamelog_header_t;
+
+/* Mistakes found replaying games, by HUMAN or COMPUTER */
+typedef struct {
+    long long games, moves, corrupt, nodes;
+    long long won[2];           /* Moves made from a forced win */
+    long long blunders[2];      /* ... that gave the forced win away */
+    long long slow[2];          /* ... that kept it, but not the fastest */
+    long long plies_lost[2];    /* Plies the slow ones added to the win */
+    long long blunders_at[REPORT_PLIES + 1];
+} replay_stats_t;
+
+/* Shared state of a replay */
+typedef struct {
+    tt_t *tt;
+    int horizon;
+    const unsigned char *data;
+    const long long *starts;    /* Offset of each game, then the file end */
+    long long num_games;
+    atomic_llong next_game;
+} replay_t;
+
+/* A replay thread and the mistakes it has found */
+typedef struct {
+    replay_t *replay;
+    replay_stats_t stats;
+} replay_worker_t;
+
+int open_game_log(const char *path);
+void log_new_game(void);
+void log_move(turn_t *turn, int computer);
+void log_undo(void);
+void close_game_log(void);
+int analyse_game_log(const char *path, int horizon, int megabytes);
+
+#endif
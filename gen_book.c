@@ -0,0 +1,76 @@
+#include "book.h"
+
+/* Build-time generator for opening_book.h: generates the game BOOK_DEPTH
+ * deep, then books best_child for every position in the first BOOK_PLIES
+ * plies, once per symmetry class, sorted by canonical key. */
+
+/* Collects an entry for every expanded turn at parent above BOOK_PLIES */
+void collect_entries(turn_t *parent, int ply, book_entry_t entries[],
+        int *num_entries) {
+    if (ply >= BOOK_PLIES || parent->num_children == 0) return;
+    int sym, i;
+    best_child_t best = best_child(parent);
+    book_entry_t *entry = &entries[(*num_entries)++];
+    entry->key = canonical_key(parent->key, &sym);
+    entry->square = sym_square(SQUARE(best.best->move.row,
+            best.best->move.col), sym);
+    entry->state = best.best->win_state ? BOOK_WIN :
+            (best.best->bad_state ? BOOK_BAD : 0);
+    entry->dist = best.best->dist;
+    for (i = 0; i < parent->num_children; i++) {
+        collect_entries(parent->children[i], ply + 1, entries, num_entries);
+    }
+}
+
+/* Orders entries by key */
+int compare_entries(const void *a, const void *b) {
+    pos_key_t key_a = ((const book_entry_t*)a)->key;
+    pos_key_t key_b = ((const book_entry_t*)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+/* Prints the opening book to stdout */
+int main(void) {
+    int ply, max_entries = 0, layer = 1, num_entries = 0, i, j;
+    for (ply = 0; ply < BOOK_PLIES; ply++) {
+        max_entries += layer;
+        layer *= NUM_SQUARES - ply;
+    }
+    book_entry_t *entries = (book_entry_t*)malloc((max_entries + 1)*
+            sizeof(book_entry_t));
+    assert(entries);
+    if (BOOK_PLIES > 0) {
+        /* An empty book needs no search, however large the board */
+        turn_t *root = make_empty_turn();
+        assert(root);
+        generate_children(root, BOOK_DEPTH);
+        collect_entries(root, 0, entries, &num_entries);
+        free_tree(root, TRUE);
+    }
+
+    /* Keep one entry per canonical key, as found first in move order */
+    qsort(entries, num_entries, sizeof(book_entry_t), compare_entries);
+    for (i = j = 0; i < num_entries; i++) {
+        if (j && entries[j-1].key == entries[i].key) continue;
+        entries[j++] = entries[i];
+    }
+    num_entries = j;
+
+    printf("/* Generated by gen_book for a %dx%d board, %d plies searched %d "
+            "deep; do not edit */\n", ROWS, COLS, BOOK_PLIES, BOOK_DEPTH);
+    printf("#ifndef _OPENING_BOOK\n#define _OPENING_BOOK\n\n");
+    printf("#if BOARD_SIZE != %d || LINE_LEN != %d || MAX_MOVES != %d || "
+            "NUM_PLAYERS != %d\n", BOARD_SIZE, LINE_LEN, MAX_MOVES,
+            NUM_PLAYERS);
+    printf("#error \"Opening book was generated for other rules\"\n#endif\n\n");
+    printf("#define BOOK_SIZE %d\n\n", num_entries);
+    printf("static const book_entry_t opening_book[%d] = {\n",
+            num_entries ? num_entries : 1);
+    for (i = 0; i < num_entries; i++) {
+        printf("    {0x%llxULL, %d, %d, %d},\n", entries[i].key,
+                entries[i].square, entries[i].state, entries[i].dist);
+    }
+    printf("%s};\n\n#endif\n", num_entries ? "" : "    {0}\n");
+    free(entries);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "game_struct.h"
+
+/* Build-time generator for move_tables.h: the mask of every winning line, and
+ * for every occupancy mask, the list of empty squares (ascending, i.e.
+ * row-major) and how many there are. Boards too large for a 2^NUM_SQUARES
+ * table get a bit-scan fallback. */
+
+/* Prints the LINE_LEN masks of every line on the board */
+void print_line_masks(void) {
+    static const int dirs[NUM_DIRS][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    unsigned int lines[NUM_DIRS*NUM_SQUARES];
+    int dir, row, col, i, num_lines = 0;
+    for (dir = 0; dir < NUM_DIRS; dir++) {
+        int d_row = dirs[dir][0], d_col = dirs[dir][1];
+        for (row = 0; row < ROWS; row++) {
+            for (col = 0; col < COLS; col++) {
+                if (!ON_BOARD(row + (LINE_LEN-1)*d_row,
+                        col + (LINE_LEN-1)*d_col)) {
+                    continue;
+                }
+                lines[num_lines] = 0;
+                for (i = 0; i < LINE_LEN; i++) {
+                    lines[num_lines] |= 1u << SQUARE(row + i*d_row,
+                            col + i*d_col);
+                }
+                num_lines++;
+            }
+        }
+    }
+    printf("#define NUM_LINES %d\n\n", num_lines);
+    printf("static const mask_t line_masks[NUM_LINES] = {");
+    for (i = 0; i < num_lines; i++) {
+        printf("%s0x%xu,", (i % 6) ? " " : "\n    ", lines[i]);
+    }
+    printf("\n};\n\n");
+}
+
+/* Prints the mask-indexed move generation tables to stdout */
+int main(void) {
+    printf("/* Generated by gen_tables for a %dx%d board; do not edit */\n",
+            ROWS, COLS);
+    printf("#ifndef _MOVE_TABLES\n#define _MOVE_TABLES\n\n");
+    /* Line masks depend on the board and line length, the rest on neither */
+    printf("#if BOARD_SIZE != %d || LINE_LEN != %d\n", BOARD_SIZE, LINE_LEN);
+    printf("#error \"Move tables were generated for other rules\"\n#endif\n\n");
+    print_line_masks();
+    if (NUM_SQUARES > MASK_TABLE_MAX_SQUARES) {
+        printf("#define HAVE_MOVE_TABLES FALSE\n\n#endif\n");
+        return 0;
+    }
+
+    int mask, sq, count, num_masks = 1 << NUM_SQUARES;
+    printf("#define HAVE_MOVE_TABLES TRUE\n\n");
+    printf("static const unsigned char empty_count[%d] = {", num_masks);
+    for (mask = 0; mask < num_masks; mask++) {
+        count = 0;
+        for (sq = 0; sq < NUM_SQUARES; sq++) {
+            if (!(mask & (1 << sq))) count++;
+        }
+        printf("%s%d,", (mask % 16) ? " " : "\n    ", count);
+    }
+    printf("\n};\n\n");
+
+    printf("static const unsigned char empty_list[%d][%d] = {\n", num_masks,
+            NUM_SQUARES);
+    for (mask = 0; mask < num_masks; mask++) {
+        printf("    {");
+        count = 0;
+        for (sq = 0; sq < NUM_SQUARES; sq++) {
+            if (!(mask & (1 << sq))) {
+                printf("%s%d", count++ ? ", " : "", sq);
+            }
+        }
+        printf("%s},\n", count ? "" : "0");
+    }
+    printf("};\n\n#endif\n");
+    return 0;
+}
@@ -0,0 +1,288 @@
+#include "level_gen.h"
+
+/* Level-synchronous generation: each layer is produced from the previous one
+ * in a single streaming pass over flat arrays, mirroring what
+ * traverse_and_create and traverse_and_update do on the turn_t tree. */
+
+/**===============================LAYER HELPERS==============================**/
+
+/* Allocates an unexpanded layer of num_nodes nodes */
+static void make_layer(layer_t *layer, int num_nodes) {
+    layer->num_nodes = num_nodes;
+    layer->keys = (pos_key_t*)malloc((num_nodes + 1)*sizeof(pos_key_t));
+    layer->flags = (unsigned char*)calloc(num_nodes + 1, sizeof(char));
+    layer->dist = (unsigned short*)calloc(num_nodes + 1, sizeof(short));
+    assert(layer->keys && layer->flags && layer->dist);
+    layer->child_start = NULL;
+}
+
+/* Allocates a level tree holding only the empty board */
+level_tree_t *make_level_tree(void) {
+    level_tree_t *tree = (level_tree_t*)malloc(sizeof(level_tree_t));
+    assert(tree);
+    tree->layers = (layer_t*)malloc(sizeof(layer_t));
+    assert(tree->layers);
+    tree->num_layers = 1;
+    make_layer(&tree->layers[0], 1);
+    tree->layers[0].keys[0] = 0;
+    return tree;
+}
+
+/* Returns the number of children of node index in layer */
+int level_num_children(layer_t *layer, int index) {
+    if (layer->child_start == NULL) return 0;
+    return layer->child_start[index+1] - layer->child_start[index];
+}
+
+/* Finds the node of layer above whose child range holds index */
+int level_parent(layer_t *above, int index) {
+    assert(above->child_start);
+    int low = 0, high = above->num_nodes - 1;
+    while (low < high) {
+        int mid = (low + high + 1)/2;
+        if (above->child_start[mid] <= index) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+/* Renders node BAD in layer, keeping the fastest opponent win */
+static void level_mark_bad(layer_t *layer, int index, int dist) {
+    if (!(layer->flags[index] & LEVEL_BAD) || dist < layer->dist[index]) {
+        layer->dist[index] = dist;
+    }
+    layer->flags[index] |= LEVEL_BAD;
+}
+
+/* Checks if node index at ply would be expanded by traverse_and_create */
+static int level_open(layer_t *layer, int index, int ply) {
+    int flags = layer->flags[index];
+    if (flags & (LEVEL_REPEAT | LEVEL_CLOSED)) return FALSE;
+    return ply == 0 || !(flags & LEVEL_DECIDED);
+}
+
+/**===============================GENERATION=================================**/
+
+/* Fills path_key with the keys from the root down to node index at ply,
+    reusing the previous path (as parents are visited in order) */
+static void level_path(level_tree_t *tree, int ply, int index,
+        int path_index[], pos_key_t path_key[], int path_valid) {
+    int level = ply;
+    path_index[level] = index;
+    path_key[level] = tree->layers[level].keys[index];
+    while (level > 0) {
+        int parent = level_parent(&tree->layers[level-1], path_index[level]);
+        level--;
+        if (path_valid && path_index[level] == parent) break;
+        path_index[level] = parent;
+        path_key[level] = tree->layers[level].keys[parent];
+    }
+}
+
+/* Checks if key at ply repeats a position of path, as is_repetition does */
+static int level_repeats(pos_key_t key, int ply, pos_key_t path_key[]) {
+    int dist;
+    for (dist = MAX_MOVES; dist <= ply; dist++) {
+        if (dist % BASE == 0 && path_key[ply - dist] == key) return TRUE;
+    }
+    return FALSE;
+}
+
+/* Creates the next layer from the children of every open frontier node */
+void level_expand(level_tree_t *tree) {
+    assert(tree);
+    int ply = tree->num_layers - 1;
+    layer_t *frontier = &tree->layers[ply];
+    unsigned char square_stor[NUM_SQUARES];
+    int i, j, count;
+
+    /* Count pass: child ranges for every open node */
+    frontier->child_start = (int*)malloc((frontier->num_nodes + 1)*
+            sizeof(int));
+    assert(frontier->child_start);
+    frontier->child_start[0] = 0;
+    for (i = 0; i < frontier->num_nodes; i++) {
+        count = 0;
+        if (level_open(frontier, i, ply)) {
+            empty_squares(key_occupied(frontier->keys[i]), &count,
+                    square_stor);
+        }
+        frontier->child_start[i+1] = frontier->child_start[i] + count;
+    }
+
+    tree->layers = (layer_t*)realloc(tree->layers,
+            (tree->num_layers + 1)*sizeof(layer_t));
+    assert(tree->layers);
+    frontier = &tree->layers[ply];
+    layer_t *next = &tree->layers[ply+1];
+    make_layer(next, frontier->child_start[frontier->num_nodes]);
+    tree->num_layers++;
+
+    /* Streaming pass over blocks of parents: write child keys, check the
+        whole block for wins at once, then cut repeats of non-winners */
+    int *path_index = (int*)malloc((ply + 2)*sizeof(int));
+    pos_key_t *path_key = (pos_key_t*)malloc((ply + 2)*sizeof(pos_key_t));
+    assert(path_index && path_key);
+    int path_valid = FALSE, entry = ply + 1, block_start = 0;
+    while (block_start < frontier->num_nodes) {
+        int block_end = block_start;
+        int first = frontier->child_start[block_start];
+        while (block_end < frontier->num_nodes &&
+                frontier->child_start[block_end] - first < LEVEL_BLOCK) {
+            int child = frontier->child_start[block_end];
+            if (level_num_children(frontier, block_end) == 0) {
+                block_end++;
+                continue;
+            }
+            const unsigned char *squares = empty_squares(
+                    key_occupied(frontier->keys[block_end]), &count,
+                    square_stor);
+            for (j = 0; j < count; j++) {
+                next->keys[child + j] = child_key(frontier->keys[block_end],
+                        squares[j], entry);
+            }
+            block_end++;
+        }
+        /* Writes 0 or 1, i.e. LEVEL_WIN, into the fresh flags */
+        int last = frontier->child_start[block_end];
+        batch_wins(next->keys + first, last - first, next->flags + first);
+
+        for (i = block_start; i < block_end; i++) {
+            if (level_num_children(frontier, i) == 0) continue;
+            level_path(tree, ply, i, path_index, path_key, path_valid);
+            path_valid = TRUE;
+            for (j = frontier->child_start[i]; j < frontier->child_start[i+1];
+                    j++) {
+                if (next->flags[j]) continue;
+                if (level_repeats(next->keys[j], ply + 1, path_key)) {
+                    next->flags[j] = LEVEL_REPEAT;
+                }
+            }
+        }
+        block_start = block_end;
+    }
+    free(path_index);
+    free(path_key);
+}
+
+#if BASE > 2
+/* As replies_all_bad on the tree: checks that every line of the other
+    players' moves, plies deep below nodes start to end - 1 of layer level,
+    reaches a BAD node, giving the slowest win from them in max_dist */
+static int level_replies_bad(level_tree_t *tree, int level, int start,
+        int end, int plies, int *max_dist) {
+    layer_t *layer = &tree->layers[level];
+    int i, dist;
+    for (i = start; i < end; i++) {
+        if (plies == 1) {
+            if (!(layer->flags[i] & LEVEL_BAD)) return FALSE;
+            dist = layer->dist[i];
+        } else {
+            dist = 0;
+            if ((layer->flags[i] & LEVEL_DECIDED) ||
+                    level_num_children(layer, i) == 0 ||
+                    !level_replies_bad(tree, level + 1,
+                    layer->child_start[i], layer->child_start[i+1],
+                    plies - 1, &dist)) {
+                return FALSE;
+            }
+            dist++;
+        }
+        if (dist > *max_dist) *max_dist = dist;
+    }
+    return TRUE;
+}
+#endif
+
+/* Applies update_bad_states and update_win_states to node index of layer,
+    whose parent is node parent of the layer above (or -1 for the root) */
+static void level_update_node(level_tree_t *tree, int level, int index,
+        int parent) {
+    layer_t *layer = &tree->layers[level];
+    layer_t *above = (parent >= 0) ? &tree->layers[level-1] : NULL;
+    int flags = layer->flags[index];
+    int num_children = level_num_children(layer, index);
+    if (num_children == 0) {
+        if ((flags & LEVEL_WIN) && above) {
+            level_mark_bad(above, parent, layer->dist[index] + 1);
+        }
+        return;
+    }
+    if (flags & LEVEL_DECIDED) return;
+
+    int max_dist = 0;
+#if BASE > 2
+    if (!level_replies_bad(tree, level + 1, layer->child_start[index],
+            layer->child_start[index+1], BASE - 1, &max_dist)) {
+        return;
+    }
+#else
+    layer_t *below = &tree->layers[level+1];
+    int i;
+    for (i = layer->child_start[index]; i < layer->child_start[index+1]; i++) {
+        if (!(below->flags[i] & LEVEL_BAD)) return;
+        if (below->dist[i] > max_dist) max_dist = below->dist[i];
+    }
+#endif
+    layer->flags[index] |= LEVEL_WIN;
+    layer->dist[index] = max_dist + 1;
+    if (above) level_mark_bad(above, parent, layer->dist[index] + 1);
+}
+
+/* Propagates win/bad states bottom up over every layer, then closes every
+    node below a decided one as traverse_and_create would skip it */
+void level_update(level_tree_t *tree) {
+    assert(tree);
+    int level, i, j;
+    for (level = tree->num_layers - 1; level > 0; level--) {
+        layer_t *above = &tree->layers[level-1];
+        for (i = 0; i < above->num_nodes; i++) {
+            for (j = above->child_start[i]; j < above->child_start[i+1]; j++) {
+                level_update_node(tree, level, j, i);
+            }
+        }
+    }
+    level_update_node(tree, 0, 0, -1);
+
+    for (level = 1; level < tree->num_layers - 1; level++) {
+        layer_t *layer = &tree->layers[level], *below = &tree->layers[level+1];
+        for (i = 0; i < layer->num_nodes; i++) {
+            if (!(layer->flags[i] & (LEVEL_CLOSED | LEVEL_DECIDED))) continue;
+            for (j = layer->child_start[i]; j < layer->child_start[i+1]; j++) {
+                below->flags[j] |= LEVEL_CLOSED;
+            }
+        }
+    }
+}
+
+/* Generate depth extra layers below the frontier */
+void level_generate(level_tree_t *tree, int depth) {
+    assert(tree);
+    int i;
+    for (i = 0; i < depth; i++) {
+        perf_start();
+        level_expand(tree);
+        long long made = tree->layers[tree->num_layers - 1].num_nodes;
+        perf_stop(PHASE_EXPAND, made);
+        perf_start();
+        level_update(tree);
+        perf_stop(PHASE_LEVEL_UPDATE, made);
+    }
+}
+
+/* Frees every layer and the tree itself */
+void free_level_tree(level_tree_t *tree) {
+    assert(tree);
+    int i;
+    for (i = 0; i < tree->num_layers; i++) {
+        free(tree->layers[i].keys);
+        free(tree->layers[i].flags);
+        free(tree->layers[i].dist);
+        free(tree->layers[i].child_start);
+    }
+    free(tree->layers);
+    free(tree);
+}
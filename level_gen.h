@@ -0,0 +1,43 @@
+#ifndef _LEVEL_GEN
+#define _LEVEL_GEN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "game_struct.h"
+#include "perfctr.h"
+#include "win_kernel.h"
+
+#define LEVEL_WIN 1         /* Node flags, as win_state etc. in turn_t */
+#define LEVEL_BAD 2
+#define LEVEL_REPEAT 4
+#define LEVEL_CLOSED 8      /* Below a decided turn, so never expanded */
+#define LEVEL_DECIDED (LEVEL_WIN | LEVEL_BAD)
+#define LEVEL_BLOCK 1024    /* Children win-checked per batch */
+
+/* One generation of the game as flat arrays of packed positions. The
+ * children of node i are nodes child_start[i] to child_start[i+1]-1 of the
+ * next layer; child_start is NULL until the layer has been expanded */
+typedef struct {
+    int num_nodes;
+    pos_key_t *keys;
+    unsigned char *flags;
+    unsigned short *dist;
+    int *child_start;
+} layer_t;
+
+/* The whole generated game, layer 0 being the empty board */
+typedef struct {
+    int num_layers;
+    layer_t *layers;
+} level_tree_t;
+
+level_tree_t *make_level_tree(void);
+int level_parent(layer_t *above, int index);
+void level_expand(level_tree_t *tree);
+void level_update(level_tree_t *tree);
+void level_generate(level_tree_t *tree, int depth);
+int level_num_children(layer_t *layer, int index);
+void free_level_tree(level_tree_t *tree);
+
+#endif
@@ -0,0 +1,346 @@
+#include "louds.h"
+
+/* Succinct tree files: the shape as a LOUDS bit sequence (two bits per
+ * turn), each turn's square and state packed in FIELD_BITS, and the dists
+ * of decided turns only, found by rank. Rank directories are stored too,
+ * so a mapped file answers child and parent queries in place. */
+
+/**===============================BIT VECTORS================================**/
+
+/* Returns the number of ones in bits before position pos */
+long long rank1(const bitvec_t *bits, long long pos) {
+    long long word = pos >> 6, w;
+    long long count = bits->ranks[word/RANK_WORDS];
+    for (w = (word/RANK_WORDS)*RANK_WORDS; w < word; w++) {
+        count += __builtin_popcountll(bits->words[w]);
+    }
+    if (pos & 63) {
+        count += __builtin_popcountll(bits->words[word] &
+                ((1ULL << (pos & 63)) - 1));
+    }
+    return count;
+}
+
+/* Returns the position of the k-th bit equal to one (if one) or zero,
+    counting from 1: a binary search of the rank directory, then a scan */
+static long long select_bit(const bitvec_t *bits, long long k, int one) {
+    long long num_words = (bits->num_bits + 63) >> 6;
+    long long num_blocks = (num_words + RANK_WORDS - 1)/RANK_WORDS;
+    long long low = 0, high = num_blocks - 1;
+    while (low < high) {
+        long long mid = (low + high + 1)/2;
+        long long before = one ? bits->ranks[mid] :
+                mid*RANK_WORDS*64 - bits->ranks[mid];
+        if (before < k) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    long long w = low*RANK_WORDS;
+    k -= one ? bits->ranks[low] : low*RANK_WORDS*64 - bits->ranks[low];
+    unsigned long long word = one ? bits->words[w] : ~bits->words[w];
+    while (__builtin_popcountll(word) < k) {
+        k -= __builtin_popcountll(word);
+        w++;
+        word = one ? bits->words[w] : ~bits->words[w];
+    }
+    while (--k > 0) word &= word - 1;
+    return w*64 + __builtin_ctzll(word);
+}
+
+/* Returns the position of the k-th one, counting from 1 */
+long long select1(const bitvec_t *bits, long long k) {
+    return select_bit(bits, k, TRUE);
+}
+
+/* Returns the position of the k-th zero, counting from 1 */
+long long select0(const bitvec_t *bits, long long k) {
+    return select_bit(bits, k, FALSE);
+}
+
+/* Returns the words of the rank directory of num_bits bits of words */
+static unsigned long long *build_ranks(const unsigned long long *words,
+        long long num_bits, long long *num_ranks) {
+    long long num_words = (num_bits + 63) >> 6, w;
+    *num_ranks = (num_words + RANK_WORDS - 1)/RANK_WORDS + 1;
+    unsigned long long *ranks = (unsigned long long*)calloc(*num_ranks,
+            sizeof(unsigned long long));
+    assert(ranks);
+    for (w = 0; w < num_words; w++) {
+        ranks[w/RANK_WORDS + 1] += __builtin_popcountll(words[w]);
+    }
+    for (w = 1; w < *num_ranks; w++) ranks[w] += ranks[w-1];
+    return ranks;
+}
+
+/* Sets bit pos of words */
+static void set_bit(unsigned long long *words, long long pos) {
+    words[pos >> 6] |= 1ULL << (pos & 63);
+}
+
+/* Writes the low num bits of value into words from bit pos */
+static void put_field(unsigned long long *words, long long pos,
+        unsigned long long value, int num) {
+    words[pos >> 6] |= value << (pos & 63);
+    if ((pos & 63) + num > 64) words[(pos >> 6) + 1] |= value >> (64 -
+            (pos & 63));
+}
+
+/* Reads num bits of words from bit pos */
+static int get_field(const unsigned long long *words, long long pos,
+        int num) {
+    unsigned long long value = words[pos >> 6] >> (pos & 63);
+    if ((pos & 63) + num > 64) value |= words[(pos >> 6) + 1] << (64 -
+            (pos & 63));
+    return (int)(value & ((1ULL << num) - 1));
+}
+
+/**=================================WRITING==================================**/
+
+/* Counts the turns at root */
+static long long count_nodes(turn_t *root) {
+    long long count = 1;
+    int i;
+    for (i = 0; i < root->num_children; i++) {
+        count += count_nodes(root->children[i]);
+    }
+    return count;
+}
+
+/* Writes num bytes to fp, padded to whole words, advancing offset */
+static int write_section(FILE *fp, const void *data, long long num,
+        long long *offset) {
+    static const char padding[8] = {0};
+    long long padded = (num + 7) & ~7LL;
+    if (fwrite(data, 1, num, fp) != (size_t)num) return FALSE;
+    if (fwrite(padding, 1, padded - num, fp) != (size_t)(padded - num)) {
+        return FALSE;
+    }
+    *offset += padded;
+    return TRUE;
+}
+
+/* Writes the tree at root to path in level order via a temporary file
+    renamed over it; returns FALSE on failure */
+int save_louds(turn_t *root, int layers_done, const char *path) {
+    assert(root);
+    long long n = count_nodes(root), head, tail = 1, pos = 2, decided = 0;
+    long long shape_words = (2*n + 1 + 63) >> 6;
+    long long field_words = ((n*FIELD_BITS + 63) >> 6) + 1;
+    long long decided_words = (n + 63) >> 6;
+    turn_t **queue = (turn_t**)malloc(n*sizeof(turn_t*));
+    unsigned long long *shape = calloc(shape_words, sizeof(*shape));
+    unsigned long long *fields = calloc(field_words, sizeof(*fields));
+    unsigned long long *decided_bits = calloc(decided_words, sizeof(*shape));
+    unsigned short *dists = (unsigned short*)malloc(n*sizeof(short));
+    assert(queue && shape && fields && decided_bits && dists);
+
+    /* Breadth first: each turn's children in unary, and its fields */
+    set_bit(shape, 0);
+    queue[0] = root;
+    for (head = 0; head < n; head++) {
+        turn_t *turn = queue[head];
+        int i, state = (turn->win_state ? LOUDS_WIN : 0) |
+                (turn->bad_state ? LOUDS_BAD : 0) |
+                (turn->repeat_state ? LOUDS_REPEAT : 0);
+        int square = (turn->move.entry == EMPTY) ? 0 :
+                SQUARE(turn->move.row, turn->move.col);
+        put_field(fields, head*FIELD_BITS, square | (state << SQ_BITS),
+                FIELD_BITS);
+        if (turn->win_state || turn->bad_state) {
+            set_bit(decided_bits, head);
+            dists[decided++] = turn->dist;
+        }
+        for (i = 0; i < turn->num_children; i++) {
+            set_bit(shape, pos++);
+            queue[tail++] = turn->children[i];
+        }
+        pos++;
+    }
+    free(queue);
+    long long shape_ranks_len, decided_ranks_len;
+    unsigned long long *shape_ranks = build_ranks(shape, 2*n + 1,
+            &shape_ranks_len);
+    unsigned long long *decided_ranks = build_ranks(decided_bits, n,
+            &decided_ranks_len);
+
+    char tmp_path[LOUDS_PATH_LEN];
+    int ok = snprintf(tmp_path, LOUDS_PATH_LEN, "%s.tmp", path) <
+            LOUDS_PATH_LEN;
+    FILE *fp = ok ? fopen(tmp_path, "wb") : NULL;
+    /* Zeroed padding and all, so the same tree writes the same bytes */
+    louds_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = LOUDS_MAGIC;
+    header.version = LOUDS_VERSION;
+    header.board_size = BOARD_SIZE;
+    header.line_len = LINE_LEN;
+    header.max_moves = MAX_MOVES;
+    header.base = BASE;
+    header.layers_done = layers_done;
+    header.num_nodes = n;
+    header.num_decided = decided;
+    long long offset = (sizeof(header) + 7) & ~7LL;
+    header.shape_offset = offset;
+    header.shape_ranks_offset = offset += shape_words*8;
+    header.fields_offset = offset += shape_ranks_len*8;
+    header.decided_offset = offset += field_words*8;
+    header.decided_ranks_offset = offset += decided_words*8;
+    header.dists_offset = offset += decided_ranks_len*8;
+    header.file_size = offset + ((decided*sizeof(short) + 7) & ~7LL);
+
+    offset = 0;
+    ok = fp != NULL &&
+            write_section(fp, &header, sizeof(header), &offset) &&
+            write_section(fp, shape, shape_words*8, &offset) &&
+            write_section(fp, shape_ranks, shape_ranks_len*8, &offset) &&
+            write_section(fp, fields, field_words*8, &offset) &&
+            write_section(fp, decided_bits, decided_words*8, &offset) &&
+            write_section(fp, decided_ranks, decided_ranks_len*8, &offset) &&
+            write_section(fp, dists, decided*sizeof(short), &offset);
+    if (fp != NULL && fclose(fp) != 0) ok = FALSE;
+    if (ok) ok = rename(tmp_path, path) == 0;
+    free(shape);
+    free(shape_ranks);
+    free(fields);
+    free(decided_bits);
+    free(decided_ranks);
+    free(dists);
+    if (ok) {
+        printf("Wrote %lld turns to %s in %lld bytes, %.1f bits per turn\n",
+                n, path, header.file_size, 8.0*header.file_size/n);
+    }
+    return ok;
+}
+
+/**================================NAVIGATION================================**/
+
+/* Maps the tree file at path read-only; NULL if it is not one for these
+    rules */
+louds_t *open_louds(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat info;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &info) == 0 &&
+            info.st_size >= (off_t)sizeof(louds_header_t)) {
+        map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+    const louds_header_t *header = (const louds_header_t*)map;
+    if (header->magic != LOUDS_MAGIC || header->version != LOUDS_VERSION ||
+            header->board_size != BOARD_SIZE ||
+            header->line_len != LINE_LEN ||
+            header->max_moves != MAX_MOVES || header->base != BASE ||
+            header->file_size != info.st_size) {
+        fprintf(stderr, "%s is not a tree file for these rules\n", path);
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    louds_t *tree = (louds_t*)malloc(sizeof(louds_t));
+    assert(tree);
+    const char *base = (const char*)map;
+    tree->map = map;
+    tree->map_size = info.st_size;
+    tree->header = header;
+    tree->shape = (bitvec_t) {
+        .words = (const unsigned long long*)(base + header->shape_offset),
+        .ranks = (const unsigned long long*)(base +
+                header->shape_ranks_offset),
+        .num_bits = 2*header->num_nodes + 1
+    };
+    tree->fields = (const unsigned long long*)(base + header->fields_offset);
+    tree->decided = (bitvec_t) {
+        .words = (const unsigned long long*)(base + header->decided_offset),
+        .ranks = (const unsigned long long*)(base +
+                header->decided_ranks_offset),
+        .num_bits = header->num_nodes
+    };
+    tree->dists = (const unsigned short*)(base + header->dists_offset);
+    return tree;
+}
+
+/* Unmaps tree */
+void close_louds(louds_t *tree) {
+    assert(tree);
+    munmap(tree->map, tree->map_size);
+    free(tree);
+}
+
+/* Returns the number of children of turn node */
+int louds_num_children(louds_t *tree, long long node) {
+    return select0(&tree->shape, node + 1) - select0(&tree->shape, node) - 1;
+}
+
+/* Returns the turn number of node's k-th child, counting from 0 */
+long long louds_child(louds_t *tree, long long node, int k) {
+    return rank1(&tree->shape, select0(&tree->shape, node) + 2 + k);
+}
+
+/* Returns the turn number of node's parent, or 0 for the root */
+long long louds_parent(louds_t *tree, long long node) {
+    long long pos = select1(&tree->shape, node);
+    return pos + 1 - rank1(&tree->shape, pos + 1);
+}
+
+/* Returns the square node's move was played on */
+int louds_square(louds_t *tree, long long node) {
+    return get_field(tree->fields, (node - 1)*FIELD_BITS, SQ_BITS);
+}
+
+/* Returns node's LOUDS_WIN, LOUDS_BAD and LOUDS_REPEAT bits */
+int louds_state(louds_t *tree, long long node) {
+    return get_field(tree->fields, (node - 1)*FIELD_BITS + SQ_BITS, 3);
+}
+
+/* Returns node's dist, or 0 if it is undecided */
+int louds_dist(louds_t *tree, long long node) {
+    if (!(louds_state(tree, node) & (LOUDS_WIN | LOUDS_BAD))) return 0;
+    return tree->dists[rank1(&tree->decided, node - 1)];
+}
+
+/**=================================IMPORT===================================**/
+
+/* Rebuilds turn from node and its subtree, navigating the mapped file */
+static void load_node(louds_t *tree, long long node, turn_t *turn) {
+    if (turn->parent != NULL) {
+        int square = louds_square(tree, node);
+        turn->move = (move_t){
+            .row = SQUARE_ROW(square),
+            .col = SQUARE_COL(square),
+            .entry = next_move(turn->parent)
+        };
+        turn->key = child_key(turn->parent->key, square, turn->move.entry);
+    }
+    int state = louds_state(tree, node);
+    turn->win_state = (state & LOUDS_WIN) ? TRUE : FALSE;
+    turn->bad_state = (state & LOUDS_BAD) ? TRUE : FALSE;
+    turn->repeat_state = (state & LOUDS_REPEAT) ? TRUE : FALSE;
+    turn->dist = louds_dist(tree, node);
+    turn->num_children = louds_num_children(tree, node);
+    if (turn->num_children == 0) return;
+
+    turn->children = alloc_children(turn->num_children);
+    long long first = louds_child(tree, node, 0);
+    int i;
+    for (i = 0; i < turn->num_children; i++) {
+        turn->children[i] = make_empty_turn();
+        turn->children[i]->parent = turn;
+        load_node(tree, first + i, turn->children[i]);
+    }
+}
+
+/* Loads the tree file at path and the layers it had generated; NULL if
+    there is no usable file */
+turn_t *load_louds(const char *path, int *layers_done) {
+    louds_t *tree = open_louds(path);
+    if (tree == NULL) return NULL;
+    turn_t *root = make_empty_turn();
+    assert(root);
+    load_node(tree, 1, root);
+    *layers_done = tree->header->layers_done;
+    close_louds(tree);
+    return root;
+}
@@ -0,0 +1,71 @@
+#ifndef _LOUDS
+#define _LOUDS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "game_struct.h"
+
+#define LOUDS_MAGIC 0x534c454fu     /* "OELS" */
+#define LOUDS_VERSION 1
+#define LOUDS_PATH_LEN 4096
+#define RANK_WORDS 8                /* Words per rank directory block */
+#define FIELD_BITS (SQ_BITS + 3)    /* Square, then the state bits */
+#define LOUDS_WIN 1
+#define LOUDS_BAD 2
+#define LOUDS_REPEAT 4
+
+/* File header; every section offset is in bytes from the file start */
+typedef struct {
+    unsigned int magic, version;
+    int board_size, line_len, max_moves, base;
+    int layers_done;
+    long long num_nodes, num_decided;
+    long long shape_offset, shape_ranks_offset;
+    long long fields_offset;
+    long long decided_offset, decided_ranks_offset;
+    long long dists_offset;
+    long long file_size;
+} louds_header_t;
+
+/* A bit vector with a rank directory: ranks[b] counts the ones before
+ * word b*RANK_WORDS */
+typedef struct {
+    const unsigned long long *words;
+    const unsigned long long *ranks;
+    long long num_bits;
+} bitvec_t;
+
+/* A tree mapped from disk. Turns are numbered from 1 in level order; the
+ * shape is LOUDS, "10" for a super-root then each turn's child count in
+ * unary, so turn x's children are consecutively numbered */
+typedef struct {
+    void *map;
+    long long map_size;
+    const louds_header_t *header;
+    bitvec_t shape;
+    const unsigned long long *fields;
+    bitvec_t decided;
+    const unsigned short *dists;
+} louds_t;
+
+long long rank1(const bitvec_t *bits, long long pos);
+long long select1(const bitvec_t *bits, long long k);
+long long select0(const bitvec_t *bits, long long k);
+int save_louds(turn_t *root, int layers_done, const char *path);
+louds_t *open_louds(const char *path);
+void close_louds(louds_t *tree);
+int louds_num_children(louds_t *tree, long long node);
+long long louds_child(louds_t *tree, long long node, int k);
+long long louds_parent(louds_t *tree, long long node);
+int louds_square(louds_t *tree, long long node);
+int louds_state(louds_t *tree, long long node);
+int louds_dist(louds_t *tree, long long node);
+turn_t *load_louds(const char *path, int *layers_done);
+
+#endif
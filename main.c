@@ -1,19 +1,185 @@
 #include "main.h"
 
 int main(int argc, char *argv[]) {
+    /* Command line options */
+    int opt, level_mode = FALSE, synchronous = FALSE, estimate = FALSE;
+    int num_threads = 0, perft_threads = 0, prove = FALSE, freeze = FALSE, tune_rounds = 0;
+    int budget_mb = OOC_DEFAULT_MB;
+    char *ooc_dir = NULL, *checkpoint_path = NULL;
+    char *read_path = NULL, *write_path = NULL;
+    char *log_path = NULL, *analyse_path = NULL, *cert_path = NULL;
+    while ((opt = getopt(argc, argv, OPTIONS)) != -1) {
+        if (opt == 'l') {
+            set_lazy_expansion(TRUE);
+        } else if (opt == 'P') {
+            /* Frees turns play may hold, so never alongside play */
+            set_pruning(TRUE);
+            synchronous = TRUE;
+        } else if (opt == 'b') {
+            level_mode = TRUE;
+        } else if (opt == 'o') {
+            ooc_dir = optarg;
+        } else if (opt == 'M') {
+            budget_mb = atoi(optarg);
+        } else if (opt == 'c') {
+            checkpoint_path = optarg;
+        } else if (opt == 's') {
+            synchronous = TRUE;
+        } else if (opt == 'e') {
+            estimate = TRUE;
+        } else if (opt == 'p') {
+            num_threads = atoi(optarg);
+        } else if (opt == 'n') {
+            prove = TRUE;
+        } else if (opt == 'r') {
+            read_path = optarg;
+        } else if (opt == 'w') {
+            write_path = optarg;
+        } else if (opt == 'f') {
+            freeze = TRUE;
+        } else if (opt == 'L') {
+            log_path = optarg;
+        } else if (opt == 'a') {
+            analyse_path = optarg;
+        } else if (opt == 'E') {
+            if (BASE != 2) {
+                /* eval_search is negamax over two sides, as the tuner */
+                fprintf(stderr, "-E needs a two-player game\n");
+                return EXIT_FAILURE;
+            }
+            set_eval_depth(atoi(optarg));
+        } else if (opt == 'T') {
+            tune_rounds = atoi(optarg);
+        } else if (opt == 't') {
+            perft_threads = atoi(optarg);
+        } else if (opt == 'x') {
+            cert_path = optarg;
+        } else if (opt == 'H') {
+            /* Counters follow the threads main creates from here on, not
+               ones running alongside it, so generation runs before play */
+            set_perf_counters(TRUE);
+            synchronous = TRUE;
+        } else {
+            fprintf(stderr, USAGE, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (prove) {
+        /* Unbounded, so no depth to ask for */
+        pos_key_t empty_board = 0;
+        dfpn_prove(&empty_board, 0, budget_mb);
+        return 0;
+    }
+    if (tune_rounds > 0) {
+        /* Self-play games search a fixed TUNE_DEPTH, so no depth either */
+        tune_weights(tune_rounds);
+        return 0;
+    }
+
     /* Simulate a new game */
     turn_t *new_game = make_empty_turn();
     assert(new_game);
     int depth;
     printf("Input depth of generation (13 is ideal): ");
     while ((scanf("%d", &depth)) != 1);
-    generate_children(new_game, depth);
+    if (estimate) {
+        /* Predictions only, to choose a depth before generating for real */
+        free_tree(new_game, TRUE);
+        estimate_tree(depth);
+        return 0;
+    }
+    if (perft_threads > 0) {
+        /* Counted move by move; nothing is kept to play through */
+        free_tree(new_game, TRUE);
+        perft(depth, perft_threads);
+        perf_report();
+        return 0;
+    }
+    if (num_threads > 0) {
+        /* Searched, not generated; nothing is kept to play through */
+        free_tree(new_game, TRUE);
+        parallel_solve(depth, num_threads, budget_mb);
+        return 0;
+    }
+    if (analyse_path != NULL) {
+        /* The depth is the solve's horizon; no tree is kept */
+        free_tree(new_game, TRUE);
+        if (!analyse_game_log(analyse_path, depth, budget_mb)) {
+            fprintf(stderr, "Cannot replay games from %s\n", analyse_path);
+            return EXIT_FAILURE;
+        }
+        return 0;
+    }
+    if (ooc_dir != NULL) {
+        /* Positions stream through disk; nothing is kept to play through */
+        free_tree(new_game, TRUE);
+        return ooc_generate(ooc_dir, depth, budget_mb);
+    }
+    if (level_mode) {
+        /* Data only; the flat layers hold no turns to play through */
+        free_tree(new_game, TRUE);
+        level_tree_t *level_tree = make_level_tree();
+        level_generate(level_tree, depth);
+        perf_report();
+        level_branching_data(level_tree);
+        free_level_tree(level_tree);
+        return 0;
+    }
+    int layers = depth;
+    if (read_path != NULL) {
+        /* Only the layers the file lacks are generated below */
+        int layers_done;
+        free_tree(new_game, TRUE);
+        new_game = load_louds(read_path, &layers_done);
+        if (new_game == NULL) {
+            fprintf(stderr, "Cannot read a tree from %s\n", read_path);
+            return EXIT_FAILURE;
+        }
+        layers = (depth > layers_done) ? depth - layers_done : 0;
+    }
+    if (checkpoint_path != NULL) {
+        free_tree(new_game, TRUE);
+        new_game = generate_with_checkpoints(depth, checkpoint_path);
+    } else if (synchronous) {
+        generate_children(new_game, layers);
+    } else {
+        /* Play starts now, on whatever has been generated so far */
+        start_background_generation(new_game, layers);
+    }
+    perf_report();
+    if (write_path != NULL) {
+        wait_background_generation();
+        if (!save_louds(new_game, depth, write_path)) {
+            fprintf(stderr, "Cannot write the tree to %s\n", write_path);
+        }
+    }
+    if (freeze) {
+        /* Read-mostly from here on, so lay it out for descents */
+        wait_background_generation();
+        descent_benchmark(new_game, "Heap layout");
+        new_game = freeze_tree(new_game);
+        descent_benchmark(new_game, "Frozen layout");
+        perf_report();
+    }
+    if (cert_path != NULL) {
+        wait_background_generation();
+        if (!new_game->win_state && !new_game->bad_state) {
+            fprintf(stderr, "The empty board is not proven at depth %d\n",
+                    depth);
+        } else if (!export_certificate(new_game, cert_path)) {
+            fprintf(stderr, "Cannot write a certificate to %s\n", cert_path);
+        }
+    }
     
     /* Obtain data */
     printf("Print data for generations (y), or continue (n)? >> ");
     int c;
     while ((c = getchar()) != EOF && !isalpha(c));
-    if (c == Y_CHAR) branching_data(new_game, depth);
+    if (c == Y_CHAR) {
+        wait_background_generation();
+        branching_data(new_game, depth);
+    }
     
     /* Main menu */
     print_intro();
@@ -24,6 +190,13 @@ int main(int argc, char *argv[]) {
     printf("Would you like hints (y) or none? >> ");
     while ((c = getchar()) != EOF && !isalpha(c));
     int hints = (c == Y_CHAR) ? TRUE : FALSE;
+    if (log_path != NULL) {
+        if (open_game_log(log_path)) {
+            log_new_game();
+        } else {
+            fprintf(stderr, "Cannot log games to %s\n", log_path);
+        }
+    }
     
     if (players == ONE_C) { /* One player AI functionality */
         printf("Would you like to go first (y) or not? >> ");
@@ -39,6 +212,10 @@ int main(int argc, char *argv[]) {
         simulator(new_game, hints, TRUE, FALSE, FALSE);
     }
     
-    free_tree(new_game, TRUE);
+    close_game_log();
+    stop_background_generation();
+    /* Every turn goes at once, rather than one free_tree call per turn */
+    release_tree_memory();
+    if (freeze) release_frozen_buffer();
     return 0;
 }
@@ -5,13 +5,52 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <assert.h>
+#include <unistd.h>
 #include "game_struct.h"
 #include "analytic.h"
 #include "user_interface.h"
+#include "level_gen.h"
+#include "ooc_gen.h"
+#include "checkpoint.h"
+#include "background.h"
+#include "estimate.h"
+#include "search.h"
+#include "dfpn.h"
+#include "louds.h"
+#include "freeze.h"
+#include "gamelog.h"
+#include "eval.h"
+#include "perft.h"
+#include "certificate.h"
 
 #define ZERO_C '0'
 #define ONE_C '1'
 #define TWO_C '2'
 #define Y_CHAR 'y'
+#define OPTIONS "lbo:M:c:sep:nPr:w:fL:a:E:T:t:x:H"
+#define USAGE "Usage: %s [-l] [-P] [-b] [-o dir [-M mb]] [-c file] [-s] [-e]\n" \
+    "       [-p threads [-M mb]] [-n [-M mb]] [-r file] [-w file] [-f]\n" \
+    "       [-L file] [-a file [-M mb]] [-E plies] [-T rounds] [-t threads]\n" \
+    "       [-x file] [-H]\n" \
+    "  -l  lazy expansion: stop expanding a turn at its first winning move\n" \
+    "  -P  prune proven turns down to their principal child as they're found\n" \
+    "  -b  breadth-first level generation into flat arrays, print data, exit\n" \
+    "  -o  out-of-core generation of distinct positions into dir, then exit\n" \
+    "  -M  memory budget in megabytes for out-of-core sorting or the table\n" \
+    "  -c  checkpoint generation to file, resuming from it if present\n" \
+    "  -s  finish generation before play instead of in the background\n" \
+    "  -r  read a succinct tree file and generate only the layers it lacks\n" \
+    "  -w  write the generated tree to a succinct tree file\n" \
+    "  -f  freeze the generated tree into one cache-oblivious buffer\n" \
+    "  -x  write a certificate of the empty board's proof, for verify_cert\n" \
+    "  -e  estimate turns, memory and time per depth from probes, then exit\n" \
+    "  -p  solve the empty board on threads sharing a table, then exit\n" \
+    "  -n  prove a forced win from the empty board by proof-number search\n" \
+    "  -L  append the game played to a binary game log\n" \
+    "  -a  replay every game in a log on all cores, report mistakes, exit\n" \
+    "  -E  search undecided turns plies deep with the static evaluation\n" \
+    "  -T  tune the evaluation weights by self-play, then exit\n" \
+    "  -t  count every line of play to the depth on threads (perft), exit\n" \
+    "  -H  report hardware counters per node for each phase of the work\n"
 
 #endif
\ No newline at end of file
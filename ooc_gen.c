@@ -0,0 +1,362 @@
+#include "ooc_gen.h"
+
+/* Out-of-core generation: every layer of distinct positions lives on disk as
+ * a sorted, delta-compressed key file. A layer is expanded by streaming its
+ * file, sorting bounded runs of child keys in memory, spilling them, and
+ * merging the runs with duplicates removed into the next layer's file.
+ * Positions are deduplicated, so this counts positions rather than paths,
+ * and repetition along a path does not apply. Layer files are renamed into
+ * place once complete, so a killed run resumes from the deepest of them. */
+
+/**================================KEY STREAMS===============================**/
+
+/* Writes the path of layer ply's file in dir into path */
+void layer_path(char *path, const char *dir, int ply) {
+    snprintf(path, OOC_PATH_LEN, "%s/layer_%03d.oel", dir, ply);
+}
+
+/* Writes the path of spill run num of the layer being built into path */
+static void run_path(char *path, const char *dir, int ply, int num) {
+    snprintf(path, OOC_PATH_LEN, "%s/run_%03d_%05d.tmp", dir, ply, num);
+}
+
+/* Opens a key file for writing, with a header whose key count is filled in
+    on closing */
+void open_key_writer(key_stream_t *stream, const char *path, int ply) {
+    stream->fp = fopen(path, "wb");
+    if (stream->fp == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    stream->buffer = (char*)malloc(OOC_IO_BUFFER);
+    assert(stream->buffer);
+    setvbuf(stream->fp, stream->buffer, _IOFBF, OOC_IO_BUFFER);
+    ooc_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = OOC_MAGIC;
+    header.ply = ply;
+    header.board_size = BOARD_SIZE;
+    header.line_len = LINE_LEN;
+    header.max_moves = MAX_MOVES;
+    header.base = BASE;
+    fwrite(&header, sizeof(header), 1, stream->fp);
+    stream->prev = 0;
+    stream->remaining = 0;
+}
+
+/* Appends key, which must not be below the previous key */
+void write_key(key_stream_t *stream, pos_key_t key) {
+    assert(key >= stream->prev);
+    pos_key_t delta = key - stream->prev;
+    stream->prev = key;
+    stream->remaining++;
+    while (delta >= 0x80) {
+        putc((int)(delta & 0x7f) | 0x80, stream->fp);
+        delta >>= 7;
+    }
+    putc((int)delta, stream->fp);
+}
+
+/* Fills in the key count and closes; returns the file size in bytes, or -1
+    if any write failed, e.g. on a full disk, so the file is incomplete */
+long long close_key_writer(key_stream_t *stream) {
+    long long num_bytes = ftell(stream->fp);
+    int failed = ferror(stream->fp) || num_bytes < 0 ||
+            fseek(stream->fp, offsetof(ooc_header_t, num_keys), SEEK_SET) ||
+            fwrite(&stream->remaining, sizeof(stream->remaining), 1,
+                stream->fp) != 1;
+    if (fclose(stream->fp) != 0) failed = TRUE;
+    free(stream->buffer);
+    return failed ? -1 : num_bytes;
+}
+
+/* Opens a key file for reading and its ply; returns FALSE if unreadable or
+    written for other rules */
+int open_key_reader(key_stream_t *stream, const char *path, int *ply) {
+    ooc_header_t header;
+    stream->fp = fopen(path, "rb");
+    if (stream->fp == NULL) return FALSE;
+    if (fread(&header, sizeof(header), 1, stream->fp) != 1 ||
+            header.magic != OOC_MAGIC || header.board_size != BOARD_SIZE ||
+            header.line_len != LINE_LEN || header.max_moves != MAX_MOVES ||
+            header.base != BASE) {
+        fclose(stream->fp);
+        return FALSE;
+    }
+    stream->buffer = (char*)malloc(OOC_IO_BUFFER);
+    assert(stream->buffer);
+    setvbuf(stream->fp, stream->buffer, _IOFBF, OOC_IO_BUFFER);
+    stream->prev = 0;
+    stream->remaining = header.num_keys;
+    if (ply) *ply = header.ply;
+    return TRUE;
+}
+
+/* Reads the next key; returns FALSE at the end of the stream */
+int read_key(key_stream_t *stream, pos_key_t *key) {
+    if (stream->remaining == 0) return FALSE;
+    pos_key_t delta = 0;
+    int c, shift = 0;
+    do {
+        c = getc(stream->fp);
+        assert(c != EOF);
+        delta |= (pos_key_t)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    stream->prev += delta;
+    stream->remaining--;
+    *key = stream->prev;
+    return TRUE;
+}
+
+/* Closes a key reader */
+void close_key_reader(key_stream_t *stream) {
+    fclose(stream->fp);
+    free(stream->buffer);
+}
+
+/**================================SPILL RUNS================================**/
+
+/* Removes spill runs first to end - 1 of the layer being built */
+static void remove_runs(const char *dir, int ply, int first, int end) {
+    char path[OOC_PATH_LEN];
+    for (; first < end; first++) {
+        run_path(path, dir, ply, first);
+        remove(path);
+    }
+}
+
+/* Orders keys for qsort */
+static int compare_keys(const void *a, const void *b) {
+    pos_key_t key_a = *(const pos_key_t*)a, key_b = *(const pos_key_t*)b;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+/* Sorts the buffered keys and writes them, without duplicates, as a run;
+    returns FALSE if it could not be written */
+static int spill_run(const char *dir, int ply, int num, pos_key_t keys[],
+        long long num_keys) {
+    char path[OOC_PATH_LEN];
+    key_stream_t stream;
+    long long i;
+    qsort(keys, num_keys, sizeof(pos_key_t), compare_keys);
+    run_path(path, dir, ply, num);
+    open_key_writer(&stream, path, ply);
+    for (i = 0; i < num_keys; i++) {
+        if (i == 0 || keys[i] != keys[i-1]) write_key(&stream, keys[i]);
+    }
+    return close_key_writer(&stream) >= 0;
+}
+
+/* Restores the min-heap of run heads below index */
+static void sift_down(pos_key_t head[], int heap[], int size, int index) {
+    while (2*index + 1 < size) {
+        int child = 2*index + 1;
+        if (child + 1 < size && head[heap[child+1]] < head[heap[child]]) {
+            child++;
+        }
+        if (head[heap[index]] <= head[heap[child]]) break;
+        int tmp = heap[index];
+        heap[index] = heap[child];
+        heap[child] = tmp;
+        index = child;
+    }
+}
+
+/* Merges runs first to first + num_runs - 1 into out_path, dropping
+    duplicates and the runs themselves, and totals what it wrote into data;
+    returns FALSE if out_path could not be written */
+static int merge_group(const char *dir, int ply, int first, int num_runs,
+        const char *out_path, ooc_layer_data_t *data) {
+    char path[OOC_PATH_LEN];
+    key_stream_t out, runs[OOC_MERGE_FANIN];
+    pos_key_t head[OOC_MERGE_FANIN];
+    int heap[OOC_MERGE_FANIN];
+    int i, size = 0;
+    assert(num_runs <= OOC_MERGE_FANIN);
+    for (i = 0; i < num_runs; i++) {
+        run_path(path, dir, ply, first + i);
+        int opened = open_key_reader(&runs[i], path, NULL);
+        assert(opened);
+        if (read_key(&runs[i], &head[i])) heap[size++] = i;
+    }
+    for (i = size/2 - 1; i >= 0; i--) {
+        sift_down(head, heap, size, i);
+    }
+
+    open_key_writer(&out, out_path, ply);
+    data->count_num = data->count_win = 0;
+    int written = FALSE;
+    while (size) {
+        int run = heap[0];
+        if (!written || head[run] != out.prev) {
+            write_key(&out, head[run]);
+            written = TRUE;
+            data->count_num++;
+            if (head[run] & OOC_WIN_BIT) data->count_win++;
+        }
+        if (!read_key(&runs[run], &head[run])) heap[0] = heap[--size];
+        sift_down(head, heap, size, 0);
+    }
+    data->num_bytes = close_key_writer(&out);
+
+    for (i = 0; i < num_runs; i++) {
+        close_key_reader(&runs[i]);
+        run_path(path, dir, ply, first + i);
+        remove(path);
+    }
+    return data->num_bytes >= 0;
+}
+
+/* Merges num_runs runs into layer ply's file and totals the layer into data,
+    in passes of at most OOC_MERGE_FANIN runs each so big layers stay within
+    the open file limit; the file is only renamed into place if every write
+    succeeded, so returns FALSE and leaves no layer otherwise */
+static int merge_runs(const char *dir, int ply, int num_runs,
+        ooc_layer_data_t *data) {
+    char path[OOC_PATH_LEN], tmp_path[OOC_PATH_LEN + 4];
+    int first = 0;
+    /* Each pass merges groups of runs into new runs numbered after them */
+    while (num_runs - first > OOC_MERGE_FANIN) {
+        int end = num_runs;
+        while (first < end) {
+            int group = (end - first < OOC_MERGE_FANIN) ? end - first :
+                    OOC_MERGE_FANIN;
+            run_path(path, dir, ply, num_runs++);
+            if (!merge_group(dir, ply, first, group, path, data)) {
+                remove_runs(dir, ply, first, num_runs);
+                return FALSE;
+            }
+            first += group;
+        }
+    }
+
+    layer_path(path, dir, ply);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (!merge_group(dir, ply, first, num_runs - first, tmp_path, data)) {
+        remove(tmp_path);
+        return FALSE;
+    }
+    if (rename(tmp_path, path) != 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    return TRUE;
+}
+
+/**================================GENERATION================================**/
+
+/* Streams layer ply from dir and writes layer ply + 1, holding at most
+    budget_keys keys in memory; returns FALSE if layer ply is unreadable or
+    layer ply + 1 could not be written */
+int ooc_expand(const char *dir, int ply, long long budget_keys,
+        ooc_layer_data_t *data) {
+    char path[OOC_PATH_LEN];
+    key_stream_t in;
+    layer_path(path, dir, ply);
+    if (!open_key_reader(&in, path, NULL)) return FALSE;
+
+    pos_key_t *keys = (pos_key_t*)malloc(budget_keys*sizeof(pos_key_t));
+    assert(keys);
+    unsigned char square_stor[NUM_SQUARES], wins[NUM_SQUARES];
+    long long num_keys = 0;
+    int num_runs = 0, count, i, entry = ply + 1, ok = TRUE;
+    pos_key_t key;
+    while (ok && read_key(&in, &key)) {
+        if (key & OOC_WIN_BIT) continue;    /* Game over, nothing follows */
+        const unsigned char *squares = empty_squares(key_occupied(key),
+                &count, square_stor);
+        if (num_keys + count > budget_keys) {
+            ok = spill_run(dir, ply + 1, num_runs++, keys, num_keys);
+            num_keys = 0;
+        }
+        for (i = 0; i < count; i++) {
+            keys[num_keys + i] = child_key(key, squares[i], entry);
+        }
+        batch_wins(keys + num_keys, count, wins);
+        for (i = 0; i < count; i++) {
+            if (wins[i]) keys[num_keys + i] |= OOC_WIN_BIT;
+        }
+        num_keys += count;
+    }
+    close_key_reader(&in);
+    if (ok) ok = spill_run(dir, ply + 1, num_runs++, keys, num_keys);
+    free(keys);
+    if (!ok) {
+        /* Runs of a failed layer are of no use to a rerun */
+        remove_runs(dir, ply + 1, 0, num_runs);
+        return FALSE;
+    }
+    return merge_runs(dir, ply + 1, num_runs, data);
+}
+
+/* Prints the totals of one layer */
+static void print_layer_data(int ply, ooc_layer_data_t *data) {
+    printf("Depth: %d\t%lld positions, %lld wins, %lld bytes on disk\n", ply,
+            data->count_num, data->count_win, data->num_bytes);
+}
+
+/* Totals an existing layer file into data; returns FALSE if unreadable */
+static int read_layer_data(const char *dir, int ply, ooc_layer_data_t *data) {
+    char path[OOC_PATH_LEN];
+    key_stream_t in;
+    pos_key_t key;
+    layer_path(path, dir, ply);
+    if (!open_key_reader(&in, path, NULL)) return FALSE;
+    data->count_num = in.remaining;
+    data->count_win = 0;
+    while (read_key(&in, &key)) {
+        if (key & OOC_WIN_BIT) data->count_win++;
+    }
+    data->num_bytes = ftell(in.fp);
+    close_key_reader(&in);
+    return TRUE;
+}
+
+/* Generates depth layers of distinct positions into dir with a sort buffer
+    of budget_mb megabytes, printing each layer's totals. Layers already in
+    dir from an earlier run are kept, resuming after the deepest */
+int ooc_generate(const char *dir, int depth, int budget_mb) {
+    assert(dir);
+    char path[OOC_PATH_LEN];
+    key_stream_t out;
+    ooc_layer_data_t data = {.count_num = 1, .count_win = 0};
+    long long budget_keys = (long long)budget_mb*(1 << 20)/sizeof(pos_key_t);
+    if (budget_keys < NUM_SQUARES) budget_keys = NUM_SQUARES;
+
+    /* Reuse completed layers, else layer 0 is the empty board */
+    int ply = 0;
+    while (ply <= depth && read_layer_data(dir, ply, &data)) {
+        print_layer_data(ply++, &data);
+    }
+    layer_path(path, dir, 0);
+    FILE *fp;
+    if (ply == 0 && (fp = fopen(path, "rb")) != NULL) {
+        /* Never written over: it may be another variant's work */
+        fclose(fp);
+        fprintf(stderr, "%s holds layers of other rules\n", dir);
+        return EXIT_FAILURE;
+    }
+    if (ply == 0) {
+        open_key_writer(&out, path, 0);
+        write_key(&out, 0);
+        data = (ooc_layer_data_t){.count_num = 1, .count_win = 0};
+        data.num_bytes = close_key_writer(&out);
+        if (data.num_bytes < 0) {
+            remove(path);
+            fprintf(stderr, "Cannot write layer 0 in %s\n", dir);
+            return EXIT_FAILURE;
+        }
+        print_layer_data(ply++, &data);
+    }
+
+    for (ply = ply - 1; ply < depth; ply++) {
+        if (!ooc_expand(dir, ply, budget_keys, &data)) {
+            fprintf(stderr, "Cannot expand layer %d in %s into layer %d\n",
+                    ply, dir, ply + 1);
+            return EXIT_FAILURE;
+        }
+        print_layer_data(ply + 1, &data);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#ifndef _OOC_GEN
+#define _OOC_GEN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+#include "game_struct.h"
+#include "win_kernel.h"
+
+#define OOC_WIN_BIT (1ULL << 63)    /* Set on keys of finished games */
+#define OOC_MAGIC 0x594c454fu       /* "OELY" */
+#define OOC_DEFAULT_MB 64           /* Default sort buffer budget */
+#define OOC_IO_BUFFER (1 << 20)
+#define OOC_PATH_LEN 4096
+#define OOC_MERGE_FANIN 64          /* Most runs open at once in a merge */
+
+/* Key file header, holding the rules so layers of other rules are refused */
+typedef struct {
+    unsigned int magic, ply;
+    int board_size, line_len, max_moves, base;
+    long long num_keys;
+} ooc_header_t;
+
+/* A compressed, sorted file of unique packed positions: a header, then each
+ * key as a LEB128 varint of its difference from the previous key */
+typedef struct {
+    FILE *fp;
+    pos_key_t prev;
+    long long remaining;
+    char *buffer;
+} key_stream_t;
+
+/* Per-layer totals of an out-of-core generation */
+typedef struct {
+    long long count_num;
+    long long count_win;
+    long long num_bytes;
+} ooc_layer_data_t;
+
+/* Key streams */
+void layer_path(char *path, const char *dir, int ply);
+void open_key_writer(key_stream_t *stream, const char *path, int ply);
+void write_key(key_stream_t *stream, pos_key_t key);
+long long close_key_writer(key_stream_t *stream);
+int open_key_reader(key_stream_t *stream, const char *path, int *ply);
+int read_key(key_stream_t *stream, pos_key_t *key);
+void close_key_reader(key_stream_t *stream);
+
+/* Generation */
+int ooc_expand(const char *dir, int ply, long long budget_keys,
+        ooc_layer_data_t *data);
+int ooc_generate(const char *dir, int depth, int budget_mb);
+
+#endif
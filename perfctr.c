@@ -0,0 +1,146 @@
+#include "perfctr.h"
+
+/* Hardware performance counters, read at phase boundaries with Linux
+ * perf_event_open and reported per node, to tell pointer chasing, allocation
+ * and branch mispredictions apart where wall time alone cannot. Only user
+ * space is counted, which an unprivileged process may do at the default
+ * perf_event_paranoid of 2. Events the kernel or machine refuses (e.g. in
+ * most VMs and containers) are reported as n/a, and times still are. */
+
+static const char *event_names[PERF_EVENTS] = {
+    "cycles", "instrs", "cache-miss", "branch-miss", "dTLB-miss"
+};
+static const char *phase_names[NUM_PHASES] = {
+    "Create", "Update", "Level expand", "Level update", "Perft",
+    "Heap descents", "Frozen descents"
+};
+
+/* Counter file descriptors, -1 where unavailable */
+static int fds[PERF_EVENTS] = {-1, -1, -1, -1, -1};
+static int counting = FALSE;
+static perf_phase_t phases[NUM_PHASES];
+
+/* Readings at the start of the phase running, one at a time */
+static double start_counts[PERF_EVENTS];
+static struct timespec start_time;
+
+/**=================================COUNTERS=================================**/
+
+/* Opens a counter of type and config for this process and the threads it
+    creates from now on; returns its descriptor, or -1 */
+static int open_counter(unsigned int type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+            PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Turns counting on or off; on, opens every counter it can and says which
+    it cannot. Threads created before this are not counted */
+void set_perf_counters(int on) {
+    int i, opened = 0, err = 0;
+    counting = on;
+    if (!on) return;
+    memset(phases, 0, sizeof(phases));
+    for (i = 0; i < PERF_EVENTS; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+    fds[0] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    err = errno;
+    fds[1] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[2] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fds[3] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    fds[4] = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    for (i = 0; i < PERF_EVENTS; i++) opened += (fds[i] >= 0);
+    if (opened == 0 && (err == EACCES || err == EPERM)) {
+        printf("Hardware counters not permitted, timing phases only; see "
+                "/proc/sys/kernel/perf_event_paranoid\n");
+    } else if (opened == 0) {
+        printf("Hardware counters unavailable (%s), timing phases only\n",
+                strerror(err));
+    } else if (opened < PERF_EVENTS) {
+        printf("Counting %d of %d hardware events, the rest shown as n/a\n",
+                opened, PERF_EVENTS);
+    }
+}
+
+/* Reads every counter into counts, scaled up for any time the kernel had it
+    multiplexed out */
+static void read_counters(double counts[]) {
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++) {
+        unsigned long long value[3];
+        counts[i] = 0;
+        if (fds[i] < 0 || read(fds[i], value, sizeof(value)) !=
+                (ssize_t)sizeof(value)) {
+            continue;
+        }
+        counts[i] = value[2] ? (double)value[0]*value[1]/value[2] : 0;
+    }
+}
+
+/**==================================PHASES==================================**/
+
+/* Starts a run of a phase; does nothing unless counting */
+void perf_start(void) {
+    if (!counting) return;
+    read_counters(start_counts);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+/* Ends the run of phase started last, which made or visited nodes */
+void perf_stop(int phase, long long nodes) {
+    if (!counting) return;
+    struct timespec end;
+    double counts[PERF_EVENTS];
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    read_counters(counts);
+    perf_phase_t *p = &phases[phase];
+    int i;
+    for (i = 0; i < PERF_EVENTS; i++) {
+        p->counts[i] += counts[i] - start_counts[i];
+    }
+    p->seconds += (end.tv_sec - start_time.tv_sec) +
+            (end.tv_nsec - start_time.tv_nsec)*1e-9;
+    p->nodes += nodes;
+    p->runs++;
+}
+
+/* Prints each phase run since the last report, its counts per node, then
+    starts afresh */
+void perf_report(void) {
+    if (!counting) return;
+    int phase, i;
+    printf("%-16s %11s %9s", "Per node", "nodes", "ns");
+    for (i = 0; i < PERF_EVENTS; i++) printf(" %11s", event_names[i]);
+    printf(" %6s\n", "IPC");
+    for (phase = 0; phase < NUM_PHASES; phase++) {
+        perf_phase_t *p = &phases[phase];
+        if (p->runs == 0) continue;
+        double per = p->nodes ? 1.0/p->nodes : 0;
+        printf("%-16s %11lld %9.2f", phase_names[phase], p->nodes,
+                p->seconds*1e9*per);
+        for (i = 0; i < PERF_EVENTS; i++) {
+            if (fds[i] < 0) {
+                printf(" %11s", "n/a");
+            } else {
+                printf(" %11.3f", p->counts[i]*per);
+            }
+        }
+        if (fds[0] >= 0 && fds[1] >= 0 && p->counts[0] > 0) {
+            printf(" %6.2f\n", p->counts[1]/p->counts[0]);
+        } else {
+            printf(" %6s\n", "n/a");
+        }
+    }
+    memset(phases, 0, sizeof(phases));
+}
@@ -0,0 +1,39 @@
+#ifndef _PERFCTR
+#define _PERFCTR
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "game_struct.h"
+
+#define PERF_EVENTS 5
+
+/* Phases counted separately */
+#define PHASE_CREATE 0          /* traverse_and_create over a layer */
+#define PHASE_UPDATE 1          /* traverse_and_update over a layer */
+#define PHASE_EXPAND 2          /* level_expand */
+#define PHASE_LEVEL_UPDATE 3    /* level_update */
+#define PHASE_PERFT 4           /* A whole perft */
+#define PHASE_HEAP_DESCENTS 5   /* descent_benchmark before freezing */
+#define PHASE_FROZEN_DESCENTS 6 /* ... and after */
+#define NUM_PHASES 7
+
+/* Counts and time summed over every run of a phase, and the nodes made or
+    visited, which the report divides them by */
+typedef struct {
+    double counts[PERF_EVENTS];
+    double seconds;
+    long long nodes;
+    int runs;
+} perf_phase_t;
+
+void set_perf_counters(int on);
+void perf_start(void);
+void perf_stop(int phase, long long nodes);
+void perf_report(void);
+
+#endif
@@ -0,0 +1,194 @@
+#include "perft.h"
+
+/* Perft: counts every line of play depth plies deep by making moves on the
+ * packed key alone, with nothing allocated, so depths far past what a tree
+ * could hold can be counted; it doubles as a move generation benchmark. A
+ * game ends at a win, but nothing else is cut: unlike generate_children,
+ * lines go on below decided turns and through repeats. */
+
+/**=================================COUNTING=================================**/
+
+/* Returns the tiles the player to move at key keeps once they move, before
+    their new one: every BASE-th slot from BASE - 1, but the oldest, which
+    vanishes */
+static mask_t next_mover_tiles(pos_key_t key) {
+    mask_t mask = 0;
+    int slot;
+    for (slot = BASE - 1; slot < MAX_MOVES - 1; slot += BASE) {
+        int sq = KEY_SLOT(key, slot);
+        mask |= (mask_t)(sq != 0) << ((sq - 1) & 31);
+    }
+    return mask;
+}
+
+/* Returns the squares of empty where the player to move at key would
+    complete a line */
+static mask_t winning_squares(pos_key_t key, mask_t empty) {
+    int num_lines, i;
+    const mask_t *lines = win_lines(&num_lines);
+    mask_t tiles = next_mover_tiles(key), wins = 0;
+    for (i = 0; i < num_lines; i++) {
+        mask_t missing = lines[i] & ~tiles;
+        wins |= missing & -(mask_t)(__builtin_popcount(missing) == 1);
+    }
+    return wins & empty;
+}
+
+/* Counts the turns below the one at key, ply deep with occupied squares,
+    down to depth. A turn is BAD if the next player can win at once; the
+    last ply's turns and wins are counted from masks without being made */
+static void perft_count(pos_key_t key, mask_t occupied, int ply, int depth,
+        perft_counts_t *counts) {
+    mask_t empty = ~occupied & (mask_t)((1ULL << NUM_SQUARES) - 1);
+    mask_t wins = winning_squares(key, empty);
+    counts->bads[ply] += (wins != 0);
+    if (ply + 1 == depth) {
+        counts->turns[depth] += __builtin_popcount(empty);
+        counts->wins[depth] += __builtin_popcount(wins);
+        return;
+    }
+    int oldest = KEY_SLOT(key, MAX_MOVES - 1);
+    mask_t vanish = (mask_t)(oldest != 0) << ((oldest - 1) & 31);
+    while (empty) {
+        int sq = __builtin_ctz(empty);
+        empty &= empty - 1;
+        counts->turns[ply+1]++;
+        if ((wins >> sq) & 1) {
+            counts->wins[ply+1]++;
+            continue;
+        }
+        perft_count(child_key(key, sq, ply + 1),
+                (occupied | (1u << sq)) & ~vanish, ply + 1, depth, counts);
+    }
+}
+
+/**=================================THREADS==================================**/
+
+/* Counts the turns above PERFT_SPLIT as perft_count does, collecting the
+    ones at PERFT_SPLIT that play goes on from */
+static void collect_tasks(perft_t *perft, pos_key_t key, int ply,
+        perft_counts_t *counts) {
+    unsigned char square_stor[NUM_SQUARES];
+    int i, count;
+    mask_t occupied = key_occupied(key);
+    const unsigned char *squares = empty_squares(occupied, &count,
+            square_stor);
+    mask_t wins = winning_squares(key, ~occupied &
+            (mask_t)((1ULL << NUM_SQUARES) - 1));
+    counts->bads[ply] += (wins != 0);
+    for (i = 0; i < count; i++) {
+        counts->turns[ply+1]++;
+        if ((wins >> squares[i]) & 1) {
+            counts->wins[ply+1]++;
+            continue;
+        }
+        pos_key_t child = child_key(key, squares[i], ply + 1);
+        if (ply + 1 == PERFT_SPLIT) {
+            perft->tasks[perft->num_tasks++] = child;
+        } else {
+            collect_tasks(perft, child, ply + 1, counts);
+        }
+    }
+}
+
+/* Worker body: counts below tasks until none are left */
+static void *perft_worker(void *arg) {
+    perft_worker_t *worker = (perft_worker_t*)arg;
+    perft_t *perft = worker->perft;
+    int task;
+    while ((task = atomic_fetch_add(&perft->next_task, 1)) <
+            perft->num_tasks) {
+        perft_count(perft->tasks[task], key_occupied(perft->tasks[task]),
+                PERFT_SPLIT, perft->depth, &worker->counts);
+    }
+    return NULL;
+}
+
+/* Adds the counts of from into to */
+static void merge_counts(perft_counts_t *to, perft_counts_t *from) {
+    int ply;
+    for (ply = 0; ply <= PERFT_MAX_DEPTH; ply++) {
+        to->turns[ply] += from->turns[ply];
+        to->wins[ply] += from->wins[ply];
+        to->bads[ply] += from->bads[ply];
+    }
+}
+
+/* Counts turns, wins and bads at every depth up to depth, sharing the turns
+    at PERFT_SPLIT among num_threads threads, and prints them in the form of
+    branching_data with the time taken and turns per second */
+void perft(int depth, int num_threads) {
+    assert(depth >= 0);
+    if (depth > PERFT_MAX_DEPTH) {
+        printf("Depth %d is too deep; counting to depth %d\n", depth,
+                PERFT_MAX_DEPTH);
+        depth = PERFT_MAX_DEPTH;
+    }
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > PERFT_MAX_THREADS) num_threads = PERFT_MAX_THREADS;
+    perft_counts_t counts;
+    memset(&counts, 0, sizeof(counts));
+    counts.turns[0] = 1;
+
+    struct timespec start, end;
+    perf_start();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (depth > PERFT_SPLIT) {
+        long long max_tasks = 1;
+        int i, t;
+        for (i = 0; i < PERFT_SPLIT; i++) max_tasks *= NUM_SQUARES;
+        perft_t perft = {.depth = depth, .num_tasks = 0};
+        perft.tasks = (pos_key_t*)malloc(max_tasks*sizeof(pos_key_t));
+        assert(perft.tasks);
+        atomic_init(&perft.next_task, 0);
+        collect_tasks(&perft, 0, 0, &counts);
+        pthread_t threads[PERFT_MAX_THREADS];
+        perft_worker_t *workers = (perft_worker_t*)calloc(num_threads,
+                sizeof(perft_worker_t));
+        assert(workers);
+        for (t = 0; t < num_threads; t++) {
+            workers[t].perft = &perft;
+            if (pthread_create(&threads[t], NULL, perft_worker,
+                    &workers[t]) != 0) {
+                /* The threads started share out every task regardless */
+                fprintf(stderr, "Started only %d of %d threads\n", t,
+                        num_threads);
+                num_threads = t;
+                break;
+            }
+        }
+        if (num_threads == 0) {
+            perft_worker(&workers[0]);
+            merge_counts(&counts, &workers[0].counts);
+        }
+        for (t = 0; t < num_threads; t++) {
+            pthread_join(threads[t], NULL);
+            merge_counts(&counts, &workers[t].counts);
+        }
+        free(workers);
+        free(perft.tasks);
+        if (num_threads == 0) num_threads = 1;
+    } else if (depth > 0) {
+        perft_count(0, 0, 0, depth, &counts);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long long turns = 0, wins = 0, bads = 0;
+    int ply;
+    for (ply = 0; ply <= depth; ply++) turns += counts.turns[ply];
+    perf_stop(PHASE_PERFT, turns);
+    turns = 0;
+    for (ply = 0; ply <= depth; ply++) {
+        printf("Depth: %d\n\tTotals:\t%lld turns, %lld wins, %lld bads\n", ply,
+                counts.turns[ply], counts.wins[ply], counts.bads[ply]);
+        turns += counts.turns[ply];
+        wins += counts.wins[ply];
+        bads += counts.bads[ply];
+    }
+    double seconds = (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec)*1e-9;
+    printf("Grand totals: %lld turns, %lld wins, %lld bads\n", turns, wins,
+            bads);
+    printf("Counted in %.3fs on %d threads, %.1f million turns/s\n", seconds,
+            num_threads, seconds > 0 ? turns/seconds*1e-6 : 0);
+}
@@ -0,0 +1,41 @@
+#ifndef _PERFT
+#define _PERFT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "game_struct.h"
+#include "perfctr.h"
+
+#define PERFT_SPLIT 2           /* Turns this deep are shared out to threads */
+#define PERFT_MAX_THREADS 256
+#define PERFT_MAX_DEPTH 64
+
+/* Counts by depth of one part of a perft */
+typedef struct {
+    long long turns[PERFT_MAX_DEPTH + 1];
+    long long wins[PERFT_MAX_DEPTH + 1];
+    long long bads[PERFT_MAX_DEPTH + 1];
+} perft_counts_t;
+
+/* Shared state of a parallel perft */
+typedef struct {
+    int depth;
+    pos_key_t *tasks;           /* Turns at PERFT_SPLIT still to play on */
+    int num_tasks;
+    atomic_int next_task;
+} perft_t;
+
+/* A perft thread and what it has counted */
+typedef struct {
+    perft_t *perft;
+    perft_counts_t counts;
+} perft_worker_t;
+
+void perft(int depth, int num_threads);
+
+#endif
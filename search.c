@@ -0,0 +1,202 @@
+#include "search.h"
+
+/* Parallel bounded solve: the state update_win_states and update_bad_states
+ * would give the root on a tree horizon deep, found by depth-first search
+ * with a shared transposition table instead of building the tree. The turns
+ * at SPLIT_PLY are shared out to worker threads, then the root is solved on
+ * top of their cached results. */
+
+/**==================================SOLVER==================================**/
+
+/* Checks if key at ply repeats a position of path, as is_repetition does */
+static int search_repeats(pos_key_t key, int ply, pos_key_t path[]) {
+    int dist;
+    for (dist = MAX_MOVES; dist <= ply; dist++) {
+        if (dist % BASE == 0 && path[ply - dist] == key) return TRUE;
+    }
+    return FALSE;
+}
+
+/* As solve, setting cut if a repeat was cut as a draw anywhere below, as
+    the result then holds only for the path that reached it */
+static int solve_path(tt_t *tt, pos_key_t path[], int ply, int horizon,
+        int *dist, long long *nodes, int *cut) {
+    pos_key_t key = path[ply];
+    (*nodes)++;
+    *cut = FALSE;
+    if (ply > 0 && mask_wins(key_mover(key))) {
+        *dist = 0;
+        return SEARCH_WIN;
+    }
+    if (horizon == 0) return SEARCH_OPEN;
+    if (ply > 0 && search_repeats(key, ply, path)) {
+        *cut = TRUE;
+        return SEARCH_OPEN;
+    }
+    tt_hit_t hit;
+    if (tt_probe(tt, key, &hit)) {
+        if (hit.flags != SEARCH_OPEN && (int)hit.value <= horizon) {
+            *dist = hit.value;
+            return hit.flags;
+        }
+        if (hit.flags == SEARCH_OPEN && hit.depth >= horizon) {
+            return SEARCH_OPEN;
+        }
+    }
+
+    unsigned char square_stor[NUM_SQUARES];
+    int i, count, child_dist, child_cut, state;
+    int all_bad = TRUE, win_dist = -1, bad_dist = 0;
+    const unsigned char *squares = empty_squares(key_occupied(key), &count,
+            square_stor);
+    for (i = 0; i < count; i++) {
+        path[ply+1] = child_key(key, squares[i], ply + 1);
+        state = solve_path(tt, path, ply + 1, horizon - 1, &child_dist, nodes,
+                &child_cut);
+        if (child_cut) *cut = TRUE;
+        if (state == SEARCH_WIN) {
+            /* Bad through the fastest winning reply */
+            if (win_dist < 0 || child_dist < win_dist) win_dist = child_dist;
+        } else if (state == SEARCH_BAD) {
+            if (child_dist > bad_dist) bad_dist = child_dist;
+        } else {
+            all_bad = FALSE;
+        }
+    }
+    if (win_dist >= 0) {
+        state = SEARCH_BAD;
+        *dist = win_dist + 1;
+    } else if (all_bad && count) {
+        state = SEARCH_WIN;
+        *dist = bad_dist + 1;
+    } else {
+        state = SEARCH_OPEN;
+        *dist = 0;
+    }
+    /* Table entries are shared by every path to key, so only results no
+       repeat has touched go in */
+    if (!*cut) tt_store(tt, key, *dist, horizon, state);
+    return state;
+}
+
+/* Solves the turn at ply of path with horizon plies below it, returning
+    SEARCH_WIN, SEARCH_BAD or SEARCH_OPEN and, if decided, the exact plies
+    to the winning move in dist, which is also the least horizon proving it.
+    Repeats are cut as draws, and results below a cut are kept out of the
+    table so they are not reused by other paths */
+int solve(tt_t *tt, pos_key_t path[], int ply, int horizon, int *dist,
+        long long *nodes) {
+    int cut;
+    return solve_path(tt, path, ply, horizon, dist, nodes, &cut);
+}
+
+/**=================================THREADS==================================**/
+
+/* Collects the path to every turn at SPLIT_PLY that solve would reach */
+static void collect_tasks(search_t *search, pos_key_t path[], int ply) {
+    if (ply > 0 && mask_wins(key_mover(path[ply]))) return;
+    if (ply == SPLIT_PLY) {
+        memcpy(search->tasks[search->num_tasks++], path,
+                (SPLIT_PLY + 1)*sizeof(pos_key_t));
+        return;
+    }
+    unsigned char square_stor[NUM_SQUARES];
+    int i, count;
+    const unsigned char *squares = empty_squares(key_occupied(path[ply]),
+            &count, square_stor);
+    for (i = 0; i < count; i++) {
+        path[ply+1] = child_key(path[ply], squares[i], ply + 1);
+        collect_tasks(search, path, ply + 1);
+    }
+}
+
+/* Worker body: solves tasks until none are left */
+static void *search_worker(void *arg) {
+    search_t *search = (search_t*)arg;
+    pos_key_t *path = (pos_key_t*)malloc((search->horizon + 1)*
+            sizeof(pos_key_t));
+    assert(path);
+    long long nodes = 0;
+    int task, dist;
+    while ((task = atomic_fetch_add(&search->next_task, 1)) <
+            search->num_tasks) {
+        memcpy(path, search->tasks[task], (SPLIT_PLY + 1)*sizeof(pos_key_t));
+        solve(search->tt, path, SPLIT_PLY, search->horizon - SPLIT_PLY,
+                &dist, &nodes);
+    }
+    atomic_fetch_add(&search->nodes, nodes);
+    tt_flush_stats(search->tt);
+    free(path);
+    return NULL;
+}
+
+/* Solves the empty board horizon plies deep on num_threads threads sharing
+    a table of megabytes, and prints the result, time and table counters */
+void parallel_solve(int horizon, int num_threads, int megabytes) {
+    assert(horizon >= 0);
+    if (BASE != 2) {
+        /* Negamax values flip between exactly two players */
+        printf("The parallel solve needs a two-player game\n");
+        return;
+    }
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+    search_t search = {.tt = make_tt(megabytes), .horizon = horizon};
+    int i, max_tasks = 1;
+    for (i = 0; i < SPLIT_PLY; i++) max_tasks *= NUM_SQUARES - i;
+    search.tasks = malloc(max_tasks*sizeof(*search.tasks));
+    pos_key_t *path = (pos_key_t*)malloc((horizon + SPLIT_PLY + 1)*
+            sizeof(pos_key_t));
+    assert(search.tasks && path);
+    atomic_init(&search.next_task, 0);
+    atomic_init(&search.nodes, 0);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (horizon > SPLIT_PLY) {
+        path[0] = 0;
+        collect_tasks(&search, path, 0);
+        pthread_t threads[MAX_THREADS];
+        for (i = 0; i < num_threads; i++) {
+            if (pthread_create(&threads[i], NULL, search_worker,
+                    &search) != 0) {
+                /* The threads started share out every task regardless */
+                fprintf(stderr, "Started only %d of %d threads\n", i,
+                        num_threads);
+                num_threads = i;
+                break;
+            }
+        }
+        if (num_threads == 0) {
+            search_worker(&search);
+            num_threads = 1;
+        } else {
+            for (i = 0; i < num_threads; i++) pthread_join(threads[i], NULL);
+        }
+    }
+    /* The root, on top of the cached task results */
+    long long nodes = 0;
+    int dist = 0;
+    path[0] = 0;
+    int state = solve(search.tt, path, 0, horizon, &dist, &nodes);
+    tt_flush_stats(search.tt);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    nodes += search.nodes;
+
+    if (state == SEARCH_BAD) {
+        printf("Odd forces a win: its winning move comes %d plies in\n",
+                dist);
+    } else if (state == SEARCH_WIN) {
+        printf("Even forces a win: its winning move comes %d plies in\n",
+                dist);
+    } else {
+        printf("Undecided %d plies deep\n", horizon);
+    }
+    printf("Searched %lld turns on %d threads in %.2fs\n", nodes,
+            num_threads, (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec)*1e-9);
+    tt_print_stats(search.tt);
+    free(search.tasks);
+    free(path);
+    free_tt(search.tt);
+}
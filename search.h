@@ -0,0 +1,34 @@
+#ifndef _SEARCH
+#define _SEARCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "game_struct.h"
+#include "tt.h"
+
+#define SEARCH_OPEN 0       /* Turn states, stored as table flags */
+#define SEARCH_WIN 1
+#define SEARCH_BAD 2
+#define SPLIT_PLY 2         /* Turns this deep are shared out to threads */
+#define MAX_THREADS 256
+
+/* Shared state of a parallel solve */
+typedef struct {
+    tt_t *tt;
+    int horizon;
+    pos_key_t (*tasks)[SPLIT_PLY + 1];  /* Path to each turn at SPLIT_PLY */
+    int num_tasks;
+    atomic_int next_task;
+    atomic_llong nodes;
+} search_t;
+
+int solve(tt_t *tt, pos_key_t path[], int ply, int horizon, int *dist,
+        long long *nodes);
+void parallel_solve(int horizon, int num_threads, int megabytes);
+
+#endif
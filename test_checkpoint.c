@@ -0,0 +1,93 @@
+#include "checkpoint.h"
+
+/* Checks that load_checkpoint rejects damaged files cleanly: every truncation
+ * of a good checkpoint, and records whose child counts or squares are out of
+ * range, must return NULL without crashing, while the file itself loads. */
+
+#define TEST_DEPTH 4
+#define TEST_PATH "test_checkpoint.tmp"
+
+/* Counts the turns in the tree at root */
+static long long count_turns(turn_t *root) {
+    long long count = 1;
+    int i;
+    for (i = 0; i < root->num_children; i++) {
+        count += count_turns(root->children[i]);
+    }
+    return count;
+}
+
+/* Writes num bytes of data to TEST_PATH */
+static void write_file(const unsigned char *data, long num) {
+    FILE *fp = fopen(TEST_PATH, "wb");
+    assert(fp);
+    assert(fwrite(data, 1, num, fp) == (size_t)num);
+    fclose(fp);
+}
+
+/* Checks that the file at TEST_PATH loads exactly when expected */
+static int check_load(int expect_tree, const char *what) {
+    int layers_done = 0;
+    turn_t *root = load_checkpoint(TEST_PATH, &layers_done);
+    int ok = (root != NULL) == expect_tree;
+    if (!ok) printf("FAIL: %s\n", what);
+    if (root != NULL) free_tree(root, TRUE);
+    return ok;
+}
+
+int main(void) {
+    turn_t *root = make_empty_turn();
+    generate_children(root, TEST_DEPTH);
+    long long num_turns = count_turns(root);
+    assert(save_checkpoint(root, TEST_DEPTH, TEST_PATH));
+    free_tree(root, TRUE);
+
+    FILE *fp = fopen(TEST_PATH, "rb");
+    assert(fp);
+    long size = sizeof(checkpoint_header_t) + num_turns*NODE_BYTES;
+    unsigned char *data = (unsigned char*)malloc(size);
+    assert(data && fread(data, 1, size, fp) == (size_t)size);
+    fclose(fp);
+
+    /* Damaged files are reported on stderr; only failures matter here */
+    int failures = 0, layers_done;
+    fflush(stderr);
+    assert(freopen("/dev/null", "w", stderr));
+    root = load_checkpoint(TEST_PATH, &layers_done);
+    if (root == NULL || count_turns(root) != num_turns ||
+            layers_done != TEST_DEPTH) {
+        printf("FAIL: an intact checkpoint does not load\n");
+        failures++;
+    }
+    if (root != NULL) free_tree(root, TRUE);
+
+    long len;
+    for (len = 0; len < size; len++) {
+        write_file(data, len);
+        failures += !check_load(FALSE, "a truncated checkpoint loads");
+    }
+    long node;
+    for (node = 0; node < num_turns; node++) {
+        unsigned char *record = data + sizeof(checkpoint_header_t) +
+                node*NODE_BYTES;
+        unsigned char saved = record[4];
+        record[4] = NUM_SQUARES + 1;
+        write_file(data, size);
+        failures += !check_load(FALSE, "a child count past the board loads");
+        record[4] = saved;
+        if (node > 0) {
+            saved = record[0];
+            record[0] = NUM_SQUARES;
+            write_file(data, size);
+            failures += !check_load(FALSE, "a square off the board loads");
+            record[0] = saved;
+        }
+    }
+    remove(TEST_PATH);
+    free(data);
+    release_tree_memory();
+
+    printf("%s: %ld truncations and each record corrupted, of a %lld-turn "
+            "checkpoint\n", failures ? "FAILED" : "PASSED", size, num_turns);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
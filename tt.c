@@ -0,0 +1,135 @@
+#include "tt.h"
+
+/* Lock-free transposition table: buckets of TT_BUCKET slots, each slot two
+ * atomic words. Stores claim a slot by compare-and-swap on its data word, so
+ * no thread ever waits on another; a lost race is counted and dropped. */
+
+/* This thread's counters, added to a table's totals by tt_flush_stats */
+static _Thread_local tt_stats_t local_stats;
+
+/**==================================TABLE===================================**/
+
+/* Allocates an empty table of at most megabytes, a power of two buckets */
+tt_t *make_tt(int megabytes) {
+    assert(megabytes > 0);
+    tt_t *tt = (tt_t*)calloc(1, sizeof(tt_t));
+    assert(tt);
+    unsigned long long bytes = (unsigned long long)megabytes << 20;
+    tt->num_buckets = 1;
+    while (tt->num_buckets*2*TT_BUCKET*sizeof(tt_entry_t) <= bytes) {
+        tt->num_buckets *= 2;
+    }
+    tt->entries = (tt_entry_t*)aligned_alloc(TT_BUCKET*sizeof(tt_entry_t),
+            tt->num_buckets*TT_BUCKET*sizeof(tt_entry_t));
+    assert(tt->entries);
+    unsigned long long i;
+    for (i = 0; i < tt->num_buckets*TT_BUCKET; i++) {
+        atomic_init(&tt->entries[i].check, 0);
+        atomic_init(&tt->entries[i].data, 0);
+    }
+    return tt;
+}
+
+/* Returns the bucket of key, spreading keys by a 64-bit mix */
+static tt_entry_t *tt_bucket(tt_t *tt, pos_key_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return &tt->entries[(key & (tt->num_buckets - 1))*TT_BUCKET];
+}
+
+/* Looks key up, writing its entry into hit; returns FALSE on a miss */
+int tt_probe(tt_t *tt, pos_key_t key, tt_hit_t *hit) {
+    tt_entry_t *bucket = tt_bucket(tt, key);
+    int i;
+    local_stats.probes++;
+    for (i = 0; i < TT_BUCKET; i++) {
+        unsigned long long data = atomic_load_explicit(&bucket[i].data,
+                memory_order_acquire);
+        unsigned long long check = atomic_load_explicit(&bucket[i].check,
+                memory_order_acquire);
+        if (!(data & TT_VALID) || (check ^ data) != key) continue;
+        hit->value = TT_VALUE(data);
+        hit->depth = TT_DEPTH(data);
+        hit->flags = TT_FLAGS(data) & ~TT_VALID;
+        local_stats.hits++;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* Stores an entry for key. It overwrites key's own slot, else fills an empty
+    one, else replaces the shallowest entry of the bucket */
+void tt_store(tt_t *tt, pos_key_t key, unsigned int value, int depth,
+        int flags) {
+    tt_entry_t *bucket = tt_bucket(tt, key);
+    tt_entry_t *victim = NULL;
+    unsigned long long victim_data = 0;
+    int i;
+    for (i = 0; i < TT_BUCKET; i++) {
+        unsigned long long data = atomic_load_explicit(&bucket[i].data,
+                memory_order_acquire);
+        unsigned long long check = atomic_load_explicit(&bucket[i].check,
+                memory_order_acquire);
+        if (!(data & TT_VALID) || (check ^ data) == key) {
+            victim = &bucket[i];
+            victim_data = data;
+            break;
+        }
+        if (victim == NULL || TT_DEPTH(data) < TT_DEPTH(victim_data)) {
+            victim = &bucket[i];
+            victim_data = data;
+        }
+    }
+
+    unsigned long long new_data = TT_PACK(value, depth, flags);
+    if (!atomic_compare_exchange_strong_explicit(&victim->data, &victim_data,
+            new_data, memory_order_acq_rel, memory_order_relaxed)) {
+        local_stats.contended++;
+        return;
+    }
+    atomic_store_explicit(&victim->check, key ^ new_data,
+            memory_order_release);
+    local_stats.stores++;
+    if (i == TT_BUCKET) local_stats.replaced++;
+}
+
+/**==================================STATS===================================**/
+
+/* Adds this thread's counters to tt's totals and clears them */
+void tt_flush_stats(tt_t *tt) {
+    atomic_fetch_add(&tt->probes, local_stats.probes);
+    atomic_fetch_add(&tt->hits, local_stats.hits);
+    atomic_fetch_add(&tt->stores, local_stats.stores);
+    atomic_fetch_add(&tt->replaced, local_stats.replaced);
+    atomic_fetch_add(&tt->contended, local_stats.contended);
+    local_stats = (tt_stats_t) {0};
+}
+
+/* Prints the flushed totals, with the hit, replacement and contention rates
+    and how full the table is */
+void tt_print_stats(tt_t *tt) {
+    long long probes = tt->probes, hits = tt->hits, stores = tt->stores;
+    long long replaced = tt->replaced, contended = tt->contended;
+    unsigned long long i, used = 0, size = tt->num_buckets*TT_BUCKET;
+    for (i = 0; i < size; i++) {
+        if (atomic_load(&tt->entries[i].data) & TT_VALID) used++;
+    }
+    printf("Table: %llu entries (%llu MB), %.1f%% full\n", size,
+            (size*sizeof(tt_entry_t)) >> 20, 100.0*used/size);
+    printf("Probes: %lld, hits: %lld (%.1f%%)\n", probes, hits,
+            probes ? 100.0*hits/probes : 0);
+    printf("Stores: %lld, replacing: %lld (%.1f%%), lost to contention: "
+            "%lld (%.3f%%)\n", stores, replaced,
+            stores ? 100.0*replaced/stores : 0, contended,
+            stores + contended ? 100.0*contended/(stores + contended) : 0);
+}
+
+/* Frees the table */
+void free_tt(tt_t *tt) {
+    assert(tt);
+    free(tt->entries);
+    free(tt);
+}
@@ -0,0 +1,55 @@
+#ifndef _TT
+#define _TT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include "game_struct.h"
+
+#define TT_BUCKET 4         /* Entries per bucket, one 64-byte cache line */
+#define TT_VALID 0x8000     /* Flag set on every stored entry */
+
+/* Packs an entry's value (32 bits), depth (16) and flags (16) in one word */
+#define TT_PACK(value, depth, flags) (((unsigned long long)(value) << 32) | \
+        ((unsigned long long)((depth) & 0xffff) << 16) | \
+        (((flags) | TT_VALID) & 0xffff))
+#define TT_VALUE(data) ((unsigned int)((data) >> 32))
+#define TT_DEPTH(data) ((int)(((data) >> 16) & 0xffff))
+#define TT_FLAGS(data) ((int)((data) & 0xffff))
+
+/* One slot: the packed data, and the key xor the data, so a slot half
+ * written by racing threads never verifies as a hit */
+typedef struct {
+    atomic_ullong check;
+    atomic_ullong data;
+} tt_entry_t;
+
+/* Counters of table traffic, kept per thread until flushed */
+typedef struct {
+    long long probes, hits, stores, replaced, contended;
+} tt_stats_t;
+
+/* Fixed-size, open-addressed table shared by any number of threads */
+typedef struct {
+    tt_entry_t *entries;
+    unsigned long long num_buckets;
+    atomic_llong probes, hits, stores, replaced, contended;
+} tt_t;
+
+/* What a probe found */
+typedef struct {
+    unsigned int value;
+    int depth;
+    int flags;
+} tt_hit_t;
+
+tt_t *make_tt(int megabytes);
+int tt_probe(tt_t *tt, pos_key_t key, tt_hit_t *hit);
+void tt_store(tt_t *tt, pos_key_t key, unsigned int value, int depth,
+        int flags);
+void tt_flush_stats(tt_t *tt);
+void tt_print_stats(tt_t *tt);
+void free_tt(tt_t *tt);
+
+#endif
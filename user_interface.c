@@ -1,43 +1,91 @@
 #include "user_interface.h"
 
-/* Turn navigation */
+/* Residue of the entries the human writes in one-player games; the computer
+    plays every other residue */
+static int human_residue = 1;
+
+/* Checks if the computer moves next after turn in a one-player game */
+static int computer_to_move(turn_t *turn) {
+    return next_move(turn) % BASE != human_residue;
+}
+
+/* Turn navigation; holds the tree lock whenever it reads or expands the tree,
+    so background work can share it, but never while waiting on the user */
 int simulator(turn_t *root, int hints, int board_print, int one_player, 
         int comp_turn) {
     assert(root);
     turn_t *curr = root;
     printf("%s", BANNER);
-    /* Computer moves */
-    if (one_player && comp_turn && root->num_children) {
+    tree_lock();
+    if (one_player && root->move.entry == EMPTY) {
+        /* Seated here, so going back to the start keeps the same seats */
+        human_residue = comp_turn ? 2 % BASE : 1;
+    }
+    /* Computer moves; the human's move may have reached the frontier, e.g.
+       below a book move, so it is expanded before being answered */
+    int sym;
+    if (one_player && comp_turn && !root->num_children && !root->win_state) {
+        generate_children(root, 1);
+    }
+    if (one_player && comp_turn && (root->num_children ||
+            book_lookup(curr->key, &sym))) {
         printf("COMPUTER MAKES A MOVE...\n");
-        generate_children(curr, 1);
-        curr = best_child(curr).best;
-        return simulator(curr, hints, TRUE, one_player, !comp_turn);
+        best_child_t best;
+        if (!book_move(curr, &best) && !pondered_move(curr, &best)) {
+            generate_children(curr, 1);
+            best = eval_best_child(curr, best_child(curr));
+        }
+        curr = best.best;
+        tree_unlock();
+        log_move(curr, TRUE);
+        return simulator(curr, hints, TRUE, one_player,
+                computer_to_move(curr));
     }
     /* Handling finished games */
     if (!root->num_children && root->win_state) {
+        tree_unlock();
         printf("GAME OVER... ");
+#if BASE > 2
+        printf("PLAYER %d WINS!", (root->move.entry - 1) % BASE + 1);
+#else
         if (root->move.entry % BASE) {
             printf("ODD WINS!");
         } else if (!one_player) {
             printf("EVEN WINS!");
         }
-        if (one_player && comp_turn) {
+#endif
+        if (one_player && root->move.entry % BASE == human_residue) {
             printf("... AND HUMANITY WON! AI CANNOT USURP US!\n");
         }
         return EXIT_SUCCESS;
     }
+    if (curr->num_children) complete_children(curr);
     print_turn(curr, (hints && board_print), board_print, hints);
+    tree_unlock();
     
-    /* User input handler and resolver */
+    /* User input handler and resolver; the computer thinks meanwhile */
     printf("Move (m) back (b) print (p) help (h) quit (q) automatic (o) >> ");
+    if (one_player) start_pondering(curr);
     int c;
     while((c = getchar()) != EOF) {
         if (!isalpha(c)) continue;
+        stop_pondering();
         if (c == 'p') return simulator(curr, hints, TRUE, one_player, comp_turn);
         if (c == 'b') {
-            if (curr->parent != NULL) curr = curr->parent;
-            if (one_player && curr->parent != NULL) curr = curr->parent;
-            return simulator(curr, hints, TRUE, one_player, comp_turn);
+            tree_lock();
+            if (curr->parent != NULL) {
+                curr = curr->parent;
+                log_undo();
+            }
+            /* Back past the computer's moves to the human's last turn */
+            while (one_player && curr->parent != NULL &&
+                    computer_to_move(curr)) {
+                curr = curr->parent;
+                log_undo();
+            }
+            tree_unlock();
+            return simulator(curr, hints, TRUE, one_player,
+                    one_player && computer_to_move(curr));
         } else if (c == 'q') {
             printf("Thank you for playing :)\n");
             return EXIT_SUCCESS;
@@ -48,37 +96,77 @@ int simulator(turn_t *root, int hints, int board_print, int one_player,
             int depth;
             printf("Enter depth of generation: ");
             scanf("%d", &depth);
+            tree_lock();
+            forget_pondering();
             generate_children(curr, depth);
+            tree_unlock();
+            return simulator(curr, hints, FALSE, one_player, comp_turn);
+        } else if (c == 'w') {
+            /* Proof-number search from here, without the tree below */
+            tree_lock();
+            int ply = curr->move.entry, i;
+            pos_key_t *path = (pos_key_t*)malloc((ply + 1)*sizeof(pos_key_t));
+            assert(path);
+            turn_t *tmp = curr;
+            for (i = ply; i >= 0; i--) {
+                path[i] = tmp->key;
+                tmp = tmp->parent;
+            }
+            tree_unlock();
+            if (ply < DFPN_MAX_PLY - 1) {
+                dfpn_prove(path, ply, DFPN_DEFAULT_MB);
+            } else {
+                printf("Turn too deep to search: %d plies in, the limit is "
+                        "%d\n", ply, DFPN_MAX_PLY - 2);
+            }
+            free(path);
             return simulator(curr, hints, FALSE, one_player, comp_turn);
         } else if (c == 'o' && hints) {
             printf("Playing strongest move...\n");
-            generate_children(curr, 1);
-            curr = best_child(curr).best;
-            return simulator(curr, hints, TRUE, one_player, !comp_turn);
+            tree_lock();
+            best_child_t best;
+            if (!book_move(curr, &best)) {
+                forget_pondering();
+                generate_children(curr, 1);
+                best = eval_best_child(curr, best_child(curr));
+            }
+            curr = best.best;
+            tree_unlock();
+            log_move(curr, TRUE);
+            return simulator(curr, hints, TRUE, one_player,
+                    one_player && computer_to_move(curr));
         } else if (c == 'o') {
             printf("Automatic is disabled when hints is disabled.\n");
             return simulator(curr, hints, FALSE, one_player, comp_turn);
         } else if (c == 'm') {
-            generate_children(curr, 1);
+            /* Pondering has deepened every reply already; a layer more would
+               leave its answers stale */
+            tree_lock();
+            if (!replies_pondered(curr)) {
+                forget_pondering();
+                generate_children(curr, 1);
+            }
+            tree_unlock();
             printf("Enter move (row x col): ");
             int row, col;
             row = col = BAD_ENTRY;
             while (scanf("%dx%d", &row, &col) != 2) {
                 printf("Invalid format, must be row# x col#...\n");
             };
-            /* Look up user entry in children */
-            int i;
-            for (i = 0; i < curr->num_children; i++) {
-                turn_t *tmp = curr->children[i];
-                if (tmp->move.entry == next_move(curr) &&
-                        tmp->move.row == row && tmp->move.col == col) {
-                    return simulator(tmp, hints, TRUE, one_player, !comp_turn);
-                }
+            /* Look up user entry in children, materialising it if lazy */
+            tree_lock();
+            turn_t *tmp = find_child(curr, row, col);
+            tree_unlock();
+            if (tmp != NULL) {
+                log_move(tmp, FALSE);
+                return simulator(tmp, hints, TRUE, one_player,
+                        one_player && computer_to_move(tmp));
             }
             printf("Invalid move...\n");
             return simulator(curr, hints, FALSE, one_player, comp_turn);
         }
     }
+    stop_pondering();
     return EXIT_SUCCESS;
 }
 
@@ -108,7 +196,15 @@ void print_board(turn_t *turn) {
     board_t curr_board;
     create_board(turn, curr_board);
     int row, col;
-    printf("x | 0  1  2\n--|---------\n");
+    printf("x |");
+    for (col = 0; col < COLS; col++) {
+        printf(" %-2d", col);
+    }
+    printf("\n--|");
+    for (col = 0; col < COLS; col++) {
+        printf("---");
+    }
+    printf("\n");
     for (row = 0; row < ROWS; row++) {
         printf("%d | ", row);
         for (col = 0; col < COLS; col++) {
@@ -124,8 +220,13 @@ void print_move(turn_t *turn, int hints) {
     assert(turn);
     printf("Move: %d @ %d x %d", turn->move.entry,  
         turn->move.row, turn->move.col);
-    if (turn->win_state && hints) printf(" (PATH TO VICTORY)");
-    if (turn->bad_state && hints) printf(" (AVOID THIS MOVE)");
+    if (turn->win_state && hints) {
+        printf(" (PATH TO VICTORY IN %d)", turn->dist/BASE + 1);
+    }
+    if (turn->bad_state && hints) {
+        printf(" (AVOID THIS MOVE, LOSES IN %d)", (turn->dist + 1)/BASE);
+    }
+    if (turn->repeat_state && hints) printf(" (REPEATS POSITION)");
     printf("\n");
 }
 
@@ -139,6 +240,8 @@ void help_information(void) {
     printf("- Generate: makes more moves in computer for play\n");
     printf("- Print: prints turn again\n");
     printf("- Automatic: makes strongest move IF hints enabled\n");
+    printf("- Win proof (w): proves whether the player to move can force "
+            "a win\n");
     return;
 }
 
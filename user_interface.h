@@ -6,6 +6,11 @@
 #include <ctype.h>
 #include <assert.h>
 #include "game_struct.h"
+#include "background.h"
+#include "book.h"
+#include "dfpn.h"
+#include "gamelog.h"
+#include "eval.h"
 
 #define BAD_ENTRY 11
 #define BANNER "=============================================================\n"
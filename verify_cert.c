@@ -0,0 +1,230 @@
+#include "certificate.h"
+
+/* Standalone verifier of proof certificates (see certificate.c). The rules
+ * come from the certificate's header and are played out here from scratch,
+ * on a plain board with no position keys, move tables or tree, so a bug in
+ * the engine cannot vouch for itself. One pass reads the file as a stream;
+ * memory is bounded by CERT_MAX_PLY whatever the proof's size. */
+
+/* Rules and game so far; squares[e] is the square of entry e, from 1 */
+typedef struct {
+    FILE *fp;
+    int size, line_len, max_moves, base, attacker;
+    int start;                  /* Entry of the proven turn */
+    int squares[CERT_MAX_PLY];
+    long long turns, choices;
+    int plies;
+    const char *error;
+} verifier_t;
+
+/* Step (row, col) for each line direction: -, |, \, / */
+static const int dirs[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+static int prove_turn(verifier_t *v, int ply);
+
+/**==================================RULES===================================**/
+
+/* Fills board with the owner of each square after entry ply, 1 + the
+    residue of its entry, or 0 where empty */
+static void make_board(verifier_t *v, int ply, int board[]) {
+    int e;
+    for (e = 0; e < v->size*v->size; e++) board[e] = 0;
+    for (e = ply; e > 0 && e > ply - v->max_moves; e--) {
+        board[v->squares[e]] = 1 + e % v->base;
+    }
+}
+
+/* Checks if square is empty after entry ply, i.e. a legal next move */
+static int is_legal(verifier_t *v, int ply, int square) {
+    int e;
+    if (square < 0 || square >= v->size*v->size) return FALSE;
+    for (e = ply; e > 0 && e > ply - v->max_moves; e--) {
+        if (v->squares[e] == square) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Checks if entry ply completes a line of its player's tiles */
+static int is_win(verifier_t *v, int ply) {
+    int board[CERT_MAX_BOARD*CERT_MAX_BOARD], dir, step;
+    make_board(v, ply, board);
+    int row = v->squares[ply] / v->size, col = v->squares[ply] % v->size;
+    int owner = board[v->squares[ply]];
+    for (dir = 0; dir < 4; dir++) {
+        int count = 1, sign;
+        for (sign = -1; sign <= 1; sign += 2) {
+            for (step = 1; ; step++) {
+                int r = row + sign*step*dirs[dir][0];
+                int c = col + sign*step*dirs[dir][1];
+                if (r < 0 || r >= v->size || c < 0 || c >= v->size ||
+                        board[r*v->size + c] != owner) {
+                    break;
+                }
+                count++;
+            }
+        }
+        if (count >= v->line_len) return TRUE;
+    }
+    return FALSE;
+}
+
+/* Checks if the position after entry ply was seen before: an earlier one
+    with the same player to move and the same window of moves */
+static int is_repeat(verifier_t *v, int ply) {
+    int dist, i;
+    for (dist = v->max_moves; dist <= ply; dist++) {
+        if (dist % v->base != 0) continue;
+        for (i = 0; i < v->max_moves; i++) {
+            int then = ply - dist - i;
+            if (then < 1 || v->squares[then] != v->squares[ply - i]) break;
+        }
+        if (i == v->max_moves) return TRUE;
+    }
+    return FALSE;
+}
+
+/**=================================CHECKING=================================**/
+
+/* Checks that entry ply, just played, wins for the attacker or leads to a
+    position proven below it; FALSE with v->error set if not */
+static int check_move(verifier_t *v, int ply) {
+    v->turns++;
+    if (is_win(v, ply)) {
+        if (ply - v->start > v->plies) v->plies = ply - v->start;
+        if (ply % v->base == v->attacker) return TRUE;
+        v->error = "another player wins";
+        return FALSE;
+    }
+    if (is_repeat(v, ply)) {
+        v->error = "a move repeats a position, which draws";
+        return FALSE;
+    }
+    if (ply + 1 >= CERT_MAX_PLY) {
+        v->error = "the proof is too deep";
+        return FALSE;
+    }
+    return prove_turn(v, ply);
+}
+
+/* Checks the proof that the attacker wins from the position after entry
+    ply: the attacker's move is read from the certificate, while every legal
+    reply of the others is played out in ascending square order */
+static int prove_turn(verifier_t *v, int ply) {
+    if ((ply + 1) % v->base == v->attacker) {
+        int square = getc(v->fp);
+        if (square == EOF) {
+            v->error = "the certificate ends early";
+            return FALSE;
+        }
+        v->choices++;
+        if (!is_legal(v, ply, square)) {
+            v->error = "the attacker plays an illegal move";
+            return FALSE;
+        }
+        v->squares[ply + 1] = square;
+        return check_move(v, ply + 1);
+    }
+    int square;
+    for (square = 0; square < v->size*v->size; square++) {
+        if (!is_legal(v, ply, square)) continue;
+        v->squares[ply + 1] = square;
+        if (!check_move(v, ply + 1)) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Checks the header's rules are ones the verifier can play */
+static int rules_supported(cert_header_t *header) {
+    return header->magic == CERT_MAGIC && header->version == CERT_VERSION &&
+            header->board_size >= 2 && header->board_size <= CERT_MAX_BOARD &&
+            header->line_len >= 2 && header->line_len <= header->board_size &&
+            header->base >= 2 && header->max_moves >= 1 &&
+            header->max_moves < header->board_size*header->board_size &&
+            header->attacker >= 0 && header->attacker < header->base &&
+            header->history >= 0 && header->history < CERT_MAX_PLY;
+}
+
+/* Replays the history, then checks the proof from where it ends; returns
+    FALSE with v->error set if any of it fails */
+static int verify(verifier_t *v, cert_header_t *header) {
+    int ply;
+    for (ply = 1; ply <= header->history; ply++) {
+        int square = getc(v->fp);
+        if (square == EOF) {
+            v->error = "the history ends early";
+            return FALSE;
+        }
+        if (!is_legal(v, ply - 1, square)) {
+            v->error = "the history holds an illegal move";
+            return FALSE;
+        }
+        v->squares[ply] = square;
+        int over = is_win(v, ply);
+        if (over && ply == header->history) {
+            /* The proven turn is the win itself */
+            if (ply % v->base == v->attacker) return TRUE;
+            v->error = "another player has won";
+            return FALSE;
+        }
+        if (over || is_repeat(v, ply)) {
+            v->error = "the game is over before the proven turn";
+            return FALSE;
+        }
+    }
+    return prove_turn(v, header->history);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s certificate\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    FILE *fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    setvbuf(fp, NULL, _IOFBF, CERT_BUFFER);
+    cert_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+            !rules_supported(&header)) {
+        fprintf(stderr, "%s is not a certificate this verifier can check\n",
+                argv[1]);
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+
+    verifier_t v = {
+        .fp = fp, .size = header.board_size, .line_len = header.line_len,
+        .max_moves = header.max_moves, .base = header.base,
+        .attacker = header.attacker, .start = header.history, .error = NULL
+    };
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int valid = verify(&v, &header);
+    if (valid && getc(fp) != EOF) {
+        valid = FALSE;
+        v.error = "bytes are left over after the proof";
+    }
+    if (valid && (v.turns != header.turns || v.choices != header.choices ||
+            v.plies != header.plies)) {
+        valid = FALSE;
+        v.error = "the proof's size differs from the header's";
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fclose(fp);
+
+    printf("%dx%d board, lines of %d, window of %d, %d players; "
+            "%d moves of history\n", header.board_size, header.board_size,
+            header.line_len, header.max_moves, header.base, header.history);
+    printf("Checked %lld turns and %lld choices in %.3fs\n", v.turns,
+            v.choices, (end.tv_sec - start.tv_sec) +
+            (end.tv_nsec - start.tv_nsec)*1e-9);
+    if (!valid) {
+        printf("INVALID: %s\n", v.error);
+        return EXIT_FAILURE;
+    }
+    printf("VALID: player %d wins within %d plies\n",
+            header.attacker ? header.attacker : header.base, header.plies);
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "win_kernel.h"
+
+/* Batch line detection: each packed position is decoded into one tile mask
+ * per residue class and every line mask is tested against the whole batch.
+ * The widest kernel the CPU supports is chosen on first use. */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS TRUE
+#else
+#define HAVE_X86_KERNELS FALSE
+#endif
+
+#define SQ_MASK ((1 << SQ_BITS) - 1)
+
+typedef void (*line_kernel_t)(const pos_key_t[], int, unsigned char[]);
+
+static line_kernel_t line_kernel = NULL;
+static const char *line_kernel_name = "none";
+
+/**==================================SCALAR==================================**/
+
+/* Decodes key into the tiles of the newest entry's residue and the one before */
+static void key_side_masks(pos_key_t key, mask_t *mover, mask_t *other) {
+    mask_t side[BASE] = {0};
+    int slot, sq;
+    for (slot = 0; slot < MAX_MOVES; slot++) {
+        if ((sq = KEY_SLOT(key, slot))) side[slot % BASE] |= 1u << (sq - 1);
+    }
+    *mover = side[0];
+    *other = side[1];
+}
+
+/* One position at a time; also finishes the tail of the vector kernels */
+static void line_flags_scalar(const pos_key_t keys[], int num,
+        unsigned char flags[]) {
+    int num_lines, i, l;
+    const mask_t *lines = win_lines(&num_lines);
+    for (i = 0; i < num; i++) {
+        mask_t mover, other;
+        key_side_masks(keys[i], &mover, &other);
+        flags[i] = 0;
+        for (l = 0; l < num_lines; l++) {
+            if ((mover & lines[l]) == lines[l]) flags[i] |= LINE_MOVER;
+            if ((other & lines[l]) == lines[l]) flags[i] |= LINE_OTHER;
+        }
+    }
+}
+
+#if HAVE_X86_KERNELS
+
+/**===================================SSE4===================================**/
+
+/* Four positions per step: scalar decode, vector line tests on 32-bit lanes */
+__attribute__((target("sse4.1")))
+static void line_flags_sse4(const pos_key_t keys[], int num,
+        unsigned char flags[]) {
+    int num_lines, i, k, l;
+    const mask_t *lines = win_lines(&num_lines);
+    for (i = 0; i + 4 <= num; i += 4) {
+        mask_t mover[4], other[4];
+        for (k = 0; k < 4; k++) {
+            key_side_masks(keys[i+k], &mover[k], &other[k]);
+        }
+        __m128i m = _mm_loadu_si128((const __m128i*)mover);
+        __m128i o = _mm_loadu_si128((const __m128i*)other);
+        __m128i win_m = _mm_setzero_si128(), win_o = _mm_setzero_si128();
+        for (l = 0; l < num_lines; l++) {
+            __m128i line = _mm_set1_epi32(lines[l]);
+            win_m = _mm_or_si128(win_m,
+                    _mm_cmpeq_epi32(_mm_and_si128(m, line), line));
+            win_o = _mm_or_si128(win_o,
+                    _mm_cmpeq_epi32(_mm_and_si128(o, line), line));
+        }
+        int bits_m = _mm_movemask_ps(_mm_castsi128_ps(win_m));
+        int bits_o = _mm_movemask_ps(_mm_castsi128_ps(win_o));
+        for (k = 0; k < 4; k++) {
+            flags[i+k] = (((bits_m >> k) & 1) ? LINE_MOVER : 0) |
+                    (((bits_o >> k) & 1) ? LINE_OTHER : 0);
+        }
+    }
+    line_flags_scalar(keys + i, num - i, flags + i);
+}
+
+/**===================================AVX2===================================**/
+
+/* Four positions per step, decoded in 64-bit lanes with variable shifts: a
+    slot holding 0 shifts by -1, which sllv turns into an empty mask */
+__attribute__((target("avx2")))
+static void line_flags_avx2(const pos_key_t keys[], int num,
+        unsigned char flags[]) {
+    int num_lines, i, k, l, slot;
+    const mask_t *lines = win_lines(&num_lines);
+    const __m256i sq_mask = _mm256_set1_epi64x(SQ_MASK);
+    const __m256i one = _mm256_set1_epi64x(1);
+    for (i = 0; i + 4 <= num; i += 4) {
+        __m256i key = _mm256_loadu_si256((const __m256i*)(keys + i));
+        __m256i side[BASE];
+        for (k = 0; k < BASE; k++) {
+            side[k] = _mm256_setzero_si256();
+        }
+        for (slot = 0; slot < MAX_MOVES; slot++) {
+            __m256i sq = _mm256_and_si256(key, sq_mask);
+            __m256i bit = _mm256_sllv_epi64(one, _mm256_sub_epi64(sq, one));
+            side[slot % BASE] = _mm256_or_si256(side[slot % BASE], bit);
+            key = _mm256_srli_epi64(key, SQ_BITS);
+        }
+        __m256i win_m = _mm256_setzero_si256(), win_o = _mm256_setzero_si256();
+        for (l = 0; l < num_lines; l++) {
+            __m256i line = _mm256_set1_epi64x(lines[l]);
+            win_m = _mm256_or_si256(win_m, _mm256_cmpeq_epi64(
+                    _mm256_and_si256(side[0], line), line));
+            win_o = _mm256_or_si256(win_o, _mm256_cmpeq_epi64(
+                    _mm256_and_si256(side[1], line), line));
+        }
+        int bits_m = _mm256_movemask_pd(_mm256_castsi256_pd(win_m));
+        int bits_o = _mm256_movemask_pd(_mm256_castsi256_pd(win_o));
+        for (k = 0; k < 4; k++) {
+            flags[i+k] = (((bits_m >> k) & 1) ? LINE_MOVER : 0) |
+                    (((bits_o >> k) & 1) ? LINE_OTHER : 0);
+        }
+    }
+    line_flags_scalar(keys + i, num - i, flags + i);
+}
+
+#endif
+
+/**=================================DISPATCH=================================**/
+
+/* Picks the widest kernel the running CPU supports */
+static void pick_line_kernel(void) {
+#if HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        line_kernel_name = "avx2";
+        line_kernel = line_flags_avx2;
+        return;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        line_kernel_name = "sse4.1";
+        line_kernel = line_flags_sse4;
+        return;
+    }
+#endif
+    line_kernel_name = "scalar";
+    line_kernel = line_flags_scalar;
+}
+
+/* Sets flags[i] to the LINE_ bits of every residue holding a line in keys[i] */
+void batch_line_flags(const pos_key_t keys[], int num, unsigned char flags[]) {
+    if (line_kernel == NULL) pick_line_kernel();
+    line_kernel(keys, num, flags);
+}
+
+/* Flags each packed position whose newest move completed a line */
+void batch_wins(const pos_key_t keys[], int num, unsigned char wins[]) {
+    int i;
+    batch_line_flags(keys, num, wins);
+    for (i = 0; i < num; i++) {
+        wins[i] &= LINE_MOVER;
+    }
+}
+
+/* Returns the name of the kernel batch_line_flags runs */
+const char *win_kernel_name(void) {
+    if (line_kernel == NULL) pick_line_kernel();
+    return line_kernel_name;
+}
@@ -0,0 +1,17 @@
+#ifndef _WIN_KERNEL
+#define _WIN_KERNEL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "game_struct.h"
+
+#define LINE_MOVER 1        /* Newest entry's residue holds a whole line */
+#define LINE_OTHER 2        /* The residue before it holds a whole line */
+
+/* Batch win detection over packed positions */
+void batch_line_flags(const pos_key_t keys[], int num, unsigned char flags[]);
+void batch_wins(const pos_key_t keys[], int num, unsigned char wins[]);
+const char *win_kernel_name(void);
+
+#endif